@@ -35,6 +35,26 @@ public:
     //==============================================================================
     void initialise (const String& commandLine) override
     {
+       #if JUCE_UNIT_TESTS
+        // "--unit-tests [category]" runs the tests of the given category, SurroundFieldMixer by default,
+        // e.g. "--unit-tests SurroundFieldMixerBenchmarks" for the benchmarks, and quits without opening a window
+        if (commandLine.startsWith("--unit-tests"))
+        {
+            auto category = commandLine.fromFirstOccurrenceOf("--unit-tests", false, false).trim();
+
+            UnitTestRunner runner;
+            runner.runTestsInCategory(category.isEmpty() ? String("SurroundFieldMixer") : category);
+
+            auto numFailures = 0;
+            for (auto resultIdx = 0; resultIdx < runner.getNumResults(); resultIdx++)
+                numFailures += runner.getResult(resultIdx)->failures;
+
+            setApplicationReturnValue(numFailures > 0 ? 1 : 0);
+            quit();
+            return;
+        }
+       #endif
+
         ignoreUnused(commandLine);
 
         mainWindow.reset (new MainWindow (getApplicationName()));
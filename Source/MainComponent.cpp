@@ -57,6 +57,12 @@ MainComponent::MainComponent()
     };
     addAndMakeVisible(m_lockLayoutButton.get());
 
+    m_processingMenuButton = std::make_unique<TextButton>("Processing");
+    m_processingMenuButton->onClick = [this] {
+        m_ssm->showProcessingMenu(m_processingMenuButton.get());
+    };
+    addAndMakeVisible(m_processingMenuButton.get());
+
     setSize(900, 600);
 }
 
@@ -118,6 +124,9 @@ void MainComponent::resized()
     setupAreaBounds.removeFromRight(margin);
     if (m_lockLayoutButton)
         m_lockLayoutButton->setBounds(setupAreaBounds.removeFromRight(100).removeFromTop(20));
+    setupAreaBounds.removeFromRight(margin);
+    if (m_processingMenuButton)
+        m_processingMenuButton->setBounds(setupAreaBounds.removeFromRight(100).removeFromTop(20));
 
     auto SurroundFieldMixerComponent = m_ssm->getUIComponent();
     if (SurroundFieldMixerComponent)
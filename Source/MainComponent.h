@@ -41,6 +41,7 @@ private:
 
     std::unique_ptr<TextButton> m_setupToggleButton;
     std::unique_ptr<TextButton> m_lockLayoutButton;
+    std::unique_ptr<TextButton> m_processingMenuButton;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -39,6 +39,12 @@ SurroundFieldMixer::SurroundFieldMixer() :
 
     m_SurroundFieldMixerProcessor->addInputCommander(m_SurroundFieldMixerRemote.get());
     m_SurroundFieldMixerProcessor->addOutputCommander(m_SurroundFieldMixerRemote.get());
+
+    // the processing settings are not per channel, the remote only forwards changes and polls them from the processor
+    m_SurroundFieldMixerRemote->delayEnabledChangeCallback = [this](bool enabled) { m_SurroundFieldMixerProcessor->setDelayEnabled(enabled); };
+    m_SurroundFieldMixerRemote->delayEnabledPollCallback = [this]() { m_SurroundFieldMixerRemote->setDelayEnabled(m_SurroundFieldMixerProcessor->getDelayEnabled()); };
+    m_SurroundFieldMixerRemote->reverbEnabledChangeCallback = [this](bool enabled) { m_SurroundFieldMixerProcessor->setReverbEnabled(enabled); };
+    m_SurroundFieldMixerRemote->reverbEnabledPollCallback = [this]() { m_SurroundFieldMixerRemote->setReverbEnabled(m_SurroundFieldMixerProcessor->getReverbEnabled()); };
 }
 
 SurroundFieldMixer::~SurroundFieldMixer()
@@ -69,15 +75,29 @@ juce::Component* SurroundFieldMixer::getDeviceSetupComponent()
 
 std::unique_ptr<XmlElement> SurroundFieldMixer::createStateXml()
 {
-    jassertfalse;
-    return nullptr;
+    if (m_SurroundFieldMixerProcessor)
+        return m_SurroundFieldMixerProcessor->createStateXml();
+    else
+        return nullptr;
 }
 
 bool SurroundFieldMixer::setStateXml(XmlElement* stateXml)
 {
-    ignoreUnused(stateXml);
-    jassertfalse;
-    return false;
+    if (!m_SurroundFieldMixerProcessor)
+        return false;
+
+    // settings that are only picked up by prepareToPlay need the running device to be restarted
+    auto renderWorkerCount = m_SurroundFieldMixerProcessor->getRenderWorkerCount();
+    auto doublePrecisionEnabled = m_SurroundFieldMixerProcessor->getDoublePrecisionEnabled();
+
+    if (!m_SurroundFieldMixerProcessor->setStateXml(stateXml))
+        return false;
+
+    if (renderWorkerCount != m_SurroundFieldMixerProcessor->getRenderWorkerCount()
+        || doublePrecisionEnabled != m_SurroundFieldMixerProcessor->getDoublePrecisionEnabled())
+        restartAudioDevice();
+
+    return true;
 }
 
 void SurroundFieldMixer::setControlOnlineState(bool online)
@@ -100,5 +120,97 @@ void SurroundFieldMixer::lockCurrentLayout(bool doLock)
         surroundFieldMixerProcessorEditor->lockCurrentLayout(doLock);
 }
 
+void SurroundFieldMixer::showProcessingMenu(juce::Component* targetComponent)
+{
+    if (!m_SurroundFieldMixerProcessor)
+        return;
+
+    // the items show the current settings, they are read again when the menu is opened the next time
+    PopupMenu processingMenu;
+    processingMenu.addItem(PMI_DelayEnabled, "Distance delay", true, m_SurroundFieldMixerProcessor->getDelayEnabled());
+    processingMenu.addItem(PMI_ReverbEnabled, "Reverb", true, m_SurroundFieldMixerProcessor->getReverbEnabled());
+
+    PopupMenu panningLawMenu;
+    auto panningLaw = m_SurroundFieldMixerProcessor->getPanningLaw();
+    panningLawMenu.addItem(PMI_PanningLawDistance, "Distance", true, panningLaw == PanningLaw::Distance);
+    panningLawMenu.addItem(PMI_PanningLawVBAP, "VBAP", true, panningLaw == PanningLaw::VBAP);
+    processingMenu.addSubMenu("Panning law", panningLawMenu);
+    processingMenu.addItem(PMI_GainFieldGridEnabled, "Precomputed gain field", true, m_SurroundFieldMixerProcessor->getGainFieldGridEnabled());
+
+    PopupMenu renderWorkerMenu;
+    auto renderWorkerCount = m_SurroundFieldMixerProcessor->getRenderWorkerCount();
+    renderWorkerMenu.addItem(PMI_RenderWorkerCountAuto, "Auto", true, renderWorkerCount < 0);
+    for (auto workerCount = 0; workerCount <= SurroundFieldMixerProcessor::s_maxRenderWorkerCount; workerCount++)
+        renderWorkerMenu.addItem(PMI_RenderWorkerCountAuto + 1 + workerCount, workerCount == 0 ? String("None") : String(workerCount), true, renderWorkerCount == workerCount);
+    processingMenu.addSubMenu("Render workers", renderWorkerMenu);
+    processingMenu.addItem(PMI_DoublePrecisionEnabled, "Double precision", true, m_SurroundFieldMixerProcessor->getDoublePrecisionEnabled());
+    processingMenu.addSeparator();
+    processingMenu.addItem(PMI_LoadSpeakerLayout, "Load speaker layout...");
+
+    processingMenu.showMenuAsync(PopupMenu::Options().withTargetComponent(targetComponent), [safeThis = SafePointer<SurroundFieldMixer>(this)](int result) {
+        if (!safeThis || !safeThis->m_SurroundFieldMixerProcessor)
+            return;
+
+        auto& processor = *safeThis->m_SurroundFieldMixerProcessor;
+        switch (result)
+        {
+        case PMI_DelayEnabled:
+            processor.setDelayEnabled(!processor.getDelayEnabled());
+            break;
+        case PMI_DoublePrecisionEnabled:
+            processor.setDoublePrecisionEnabled(!processor.getDoublePrecisionEnabled());
+            safeThis->restartAudioDevice();
+            break;
+        case PMI_ReverbEnabled:
+            processor.setReverbEnabled(!processor.getReverbEnabled());
+            break;
+        case PMI_PanningLawDistance:
+            processor.setPanningLaw(PanningLaw::Distance);
+            break;
+        case PMI_PanningLawVBAP:
+            processor.setPanningLaw(PanningLaw::VBAP);
+            break;
+        case PMI_GainFieldGridEnabled:
+            processor.setGainFieldGridEnabled(!processor.getGainFieldGridEnabled());
+            break;
+        case PMI_LoadSpeakerLayout:
+            safeThis->chooseSpeakerLayoutFile();
+            break;
+        default:
+            if (result >= PMI_RenderWorkerCountAuto && result <= PMI_RenderWorkerCountAuto + 1 + SurroundFieldMixerProcessor::s_maxRenderWorkerCount)
+            {
+                processor.setRenderWorkerCount(result - PMI_RenderWorkerCountAuto - 1);
+                safeThis->restartAudioDevice();
+            }
+            break;
+        }
+    });
+}
+
+void SurroundFieldMixer::restartAudioDevice()
+{
+    auto deviceManager = m_SurroundFieldMixerProcessor ? m_SurroundFieldMixerProcessor->getDeviceManager() : nullptr;
+    if (!deviceManager || !deviceManager->getCurrentAudioDevice())
+        return;
+
+    // reopening the device runs prepareToPlay again, with the current settings
+    deviceManager->closeAudioDevice();
+    deviceManager->restartLastAudioDevice();
+}
+
+void SurroundFieldMixer::chooseSpeakerLayoutFile()
+{
+    // the chooser has to outlive the async dialog, so it is kept as a member
+    m_speakerLayoutChooser = std::make_unique<FileChooser>("Load speaker layout", File::getSpecialLocation(File::userDocumentsDirectory), "*.xml");
+    m_speakerLayoutChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [safeThis = SafePointer<SurroundFieldMixer>(this)](const FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (!safeThis || !safeThis->m_SurroundFieldMixerProcessor || file == File())
+            return;
+
+        if (!safeThis->m_SurroundFieldMixerProcessor->loadSpeakerLayout(file))
+            AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon, "Load speaker layout", file.getFileName() + " does not contain a valid speaker layout.");
+    });
+}
+
 
 }
\ No newline at end of file
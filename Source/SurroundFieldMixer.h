@@ -60,8 +60,25 @@ public:
     //==========================================================================
     void lockCurrentLayout(bool doLock);
 
+    //==========================================================================
+    void showProcessingMenu(juce::Component* targetComponent);
+
 private:
+    enum ProcessingMenuItemId
+    {
+        PMI_DelayEnabled = 1,
+        PMI_DoublePrecisionEnabled,
+        PMI_LoadSpeakerLayout,
+        PMI_PanningLawDistance,
+        PMI_PanningLawVBAP,
+        PMI_GainFieldGridEnabled,
+        PMI_ReverbEnabled,
+        PMI_RenderWorkerCountAuto = 100, // followed by one item per fixed worker count, starting with 0
+    };
+
     void setControlOnlineState(bool online);
+    void restartAudioDevice();
+    void chooseSpeakerLayoutFile();
 
 
     std::unique_ptr<SurroundFieldMixerProcessor>        m_SurroundFieldMixerProcessor;
@@ -72,6 +89,8 @@ private:
     std::unique_ptr<SurroundFieldMixerEditor>           m_audioVisuComponent;
     std::unique_ptr<AudioSelectComponent>               m_audioDeviceSelectComponent;
 
+    std::unique_ptr<FileChooser>                        m_speakerLayoutChooser;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SurroundFieldMixer)
 };
 
@@ -0,0 +1,152 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AudioBufferFifo.h"
+
+namespace SurroundFieldMixer
+{
+
+namespace
+{
+
+void copySamples(float* destination, const float* source, int numSamples)
+{
+	FloatVectorOperations::copy(destination, source, numSamples);
+}
+
+void copySamples(float* destination, const double* source, int numSamples)
+{
+	for (auto i = 0; i < numSamples; i++)
+		destination[i] = static_cast<float>(source[i]);
+}
+
+} // namespace
+
+//==============================================================================
+AudioBufferFifo::AudioBufferFifo()
+{
+}
+
+AudioBufferFifo::~AudioBufferFifo()
+{
+}
+
+void AudioBufferFifo::setSize(int numChannels, int capacityInSamples, AudioMemoryArena& memory)
+{
+	// must not be called while producer or consumer are active
+	m_channels.resize(numChannels);
+	for (auto& channel : m_channels)
+		channel = memory.take(capacityInSamples);
+	if (std::find(m_channels.begin(), m_channels.end(), nullptr) != m_channels.end())
+		m_channels.clear();
+
+	m_fifo.setTotalSize(capacityInSamples);
+	m_numChannels = 0;
+	m_numDroppedBlocks = 0;
+}
+
+void AudioBufferFifo::reset()
+{
+	m_fifo.reset();
+	m_numChannels = 0;
+}
+
+bool AudioBufferFifo::push(const AudioBuffer<float>& buffer)
+{
+	return push(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+bool AudioBufferFifo::push(const float* const* channelData, int numChannels, int numSamples)
+{
+	return pushSamples(channelData, numChannels, numSamples);
+}
+
+bool AudioBufferFifo::push(const double* const* channelData, int numChannels, int numSamples)
+{
+	// the consumers only ever work on single precision, so double data is converted on the way in
+	return pushSamples(channelData, numChannels, numSamples);
+}
+
+template <typename SampleType>
+bool AudioBufferFifo::pushSamples(const SampleType* const* channelData, int numChannels, int numSamples)
+{
+	numChannels = jmin(numChannels, static_cast<int>(m_channels.size()));
+
+	if (numSamples > m_fifo.getFreeSpace())
+	{
+		m_numDroppedBlocks++;
+		return false;
+	}
+
+	int start1, size1, start2, size2;
+	m_fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+	for (auto i = 0; i < numChannels; i++)
+	{
+		if (size1 > 0)
+			copySamples(m_channels[i] + start1, channelData[i], size1);
+		if (size2 > 0)
+			copySamples(m_channels[i] + start2, channelData[i] + size1, size2);
+	}
+	m_numChannels = numChannels;
+	m_fifo.finishedWrite(size1 + size2);
+
+	return true;
+}
+
+int AudioBufferFifo::pull(AudioBuffer<float>& destination, int maxNumSamples)
+{
+	auto numChannels = m_numChannels.load();
+
+	int start1, size1, start2, size2;
+	m_fifo.prepareToRead(maxNumSamples, start1, size1, start2, size2);
+
+	// destination is expected to have been allocated large enough by the consumer, so this only adjusts its view
+	destination.setSize(numChannels, size1 + size2, false, false, true);
+	for (auto i = 0; i < numChannels; i++)
+	{
+		if (size1 > 0)
+			destination.copyFrom(i, 0, m_channels[i] + start1, size1);
+		if (size2 > 0)
+			destination.copyFrom(i, size1, m_channels[i] + start2, size2);
+	}
+	m_fifo.finishedRead(size1 + size2);
+
+	return size1 + size2;
+}
+
+int AudioBufferFifo::getNumReady() const
+{
+	return m_fifo.getNumReady();
+}
+
+int AudioBufferFifo::getNumChannels() const
+{
+	return m_numChannels;
+}
+
+int AudioBufferFifo::getNumDroppedBlocks() const
+{
+	return m_numDroppedBlocks;
+}
+
+size_t AudioBufferFifo::getRequiredMemorySize(int numChannels, int capacityInSamples)
+{
+	return static_cast<size_t>(numChannels) * AudioMemoryArena::getPaddedSize(static_cast<size_t>(capacityInSamples));
+}
+
+} // namespace SurroundFieldMixer
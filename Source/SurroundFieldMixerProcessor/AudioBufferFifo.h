@@ -0,0 +1,73 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "AudioMemoryArena.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Preallocated single producer / single consumer multichannel sample fifo.
+ * The audio thread pushes complete blocks, the consumer pulls whatever is
+ * available from its own context. If the consumer falls behind, blocks that
+ * do not fit anymore are dropped instead of blocking or allocating.
+ * The sample memory is taken from an AudioMemoryArena owned by the caller.
+ */
+class AudioBufferFifo
+{
+public:
+    AudioBufferFifo();
+    ~AudioBufferFifo();
+
+    //==============================================================================
+    void setSize(int numChannels, int capacityInSamples, AudioMemoryArena& memory);
+    void reset();
+
+    //==============================================================================
+    bool push(const AudioBuffer<float>& buffer);
+    bool push(const float* const* channelData, int numChannels, int numSamples);
+    bool push(const double* const* channelData, int numChannels, int numSamples);
+    int pull(AudioBuffer<float>& destination, int maxNumSamples);
+
+    //==============================================================================
+    int getNumReady() const;
+    int getNumChannels() const;
+    int getNumDroppedBlocks() const;
+
+    //==============================================================================
+    static size_t getRequiredMemorySize(int numChannels, int capacityInSamples);
+
+private:
+    template <typename SampleType>
+    bool pushSamples(const SampleType* const* channelData, int numChannels, int numSamples);
+
+    AbstractFifo        m_fifo{ 1 };
+    std::vector<float*> m_channels;
+    std::atomic<int>    m_numChannels{ 0 };
+    std::atomic<int>    m_numDroppedBlocks{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioBufferFifo)
+};
+
+} // namespace SurroundFieldMixer
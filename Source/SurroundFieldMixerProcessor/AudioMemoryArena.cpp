@@ -0,0 +1,118 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AudioMemoryArena.h"
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace SurroundFieldMixer
+{
+
+AudioMemoryArena::AudioMemoryArena()
+{
+}
+
+AudioMemoryArena::~AudioMemoryArena()
+{
+	release();
+}
+
+bool AudioMemoryArena::allocate(size_t numFloats, bool lockMemory)
+{
+	release();
+
+	numFloats = getPaddedSize(numFloats);
+	if (numFloats == 0)
+		return true;
+
+	// over allocate by one alignment step, so the usable part can start on a cache line boundary
+	m_memory.calloc(numFloats * sizeof(float) + s_alignment);
+	if (m_memory.get() == nullptr)
+		return false;
+
+	auto address = reinterpret_cast<uintptr_t>(m_memory.get());
+	m_data = reinterpret_cast<float*>((address + s_alignment - 1) & ~static_cast<uintptr_t>(s_alignment - 1));
+	m_size = numFloats;
+	m_numUsed = 0;
+
+	if (lockMemory)
+		this->lockMemory();
+
+	return true;
+}
+
+void AudioMemoryArena::release()
+{
+	unlockMemory();
+
+	m_memory.free();
+	m_data = nullptr;
+	m_size = 0;
+	m_numUsed = 0;
+}
+
+float* AudioMemoryArena::take(size_t numFloats)
+{
+	// the arena is sized up front for everything that is taken from it
+	numFloats = getPaddedSize(numFloats);
+	if (m_data == nullptr || m_numUsed + numFloats > m_size)
+	{
+		jassertfalse;
+		return nullptr;
+	}
+
+	auto data = m_data + m_numUsed;
+	m_numUsed += numFloats;
+	return data;
+}
+
+size_t AudioMemoryArena::getPaddedSize(size_t numFloats)
+{
+	constexpr auto floatsPerAlignment = s_alignment / sizeof(float);
+	return (numFloats + floatsPerAlignment - 1) / floatsPerAlignment * floatsPerAlignment;
+}
+
+void AudioMemoryArena::lockMemory()
+{
+	// locking is best effort, it usually fails when the process memory lock limit is too small. Callers check isLocked().
+#if JUCE_WINDOWS
+	m_isLocked = VirtualLock(m_data, m_size * sizeof(float)) != 0;
+#else
+	m_isLocked = mlock(m_data, m_size * sizeof(float)) == 0;
+#endif
+}
+
+void AudioMemoryArena::unlockMemory()
+{
+	if (!m_isLocked)
+		return;
+
+#if JUCE_WINDOWS
+	VirtualUnlock(m_data, m_size * sizeof(float));
+#else
+	munlock(m_data, m_size * sizeof(float));
+#endif
+
+	m_isLocked = false;
+}
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,92 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Single block of working audio memory that is allocated once at prepare time
+ * and handed out in cache line aligned, contiguous pieces. The block can
+ * optionally be locked into physical memory, so the audio thread does not
+ * run into page faults when touching it for the first time.
+ */
+class AudioMemoryArena
+{
+public:
+    AudioMemoryArena();
+    ~AudioMemoryArena();
+
+    //==============================================================================
+    bool allocate(size_t numFloats, bool lockMemory);
+    void release();
+    float* take(size_t numFloats);
+    // piece for numSamples of the given sample type, e.g. double channels are taken as twice the number of floats
+    template <typename SampleType>
+    SampleType* takeSamples(size_t numSamples)
+    {
+        static_assert(sizeof(SampleType) % sizeof(float) == 0, "sample type must be a multiple of float in size");
+        return reinterpret_cast<SampleType*>(take(numSamples * (sizeof(SampleType) / sizeof(float))));
+    }
+    // piece for numObjects default constructed objects, e.g. gain ramps. The arena never runs destructors.
+    template <typename ObjectType>
+    ObjectType* takeObjects(size_t numObjects)
+    {
+        static_assert(std::is_trivially_destructible<ObjectType>::value, "objects in the arena are never destroyed");
+        static_assert(alignof(ObjectType) <= s_alignment, "objects in the arena are at most cache line aligned");
+        auto objects = reinterpret_cast<ObjectType*>(take(getSizeForObjects<ObjectType>(numObjects)));
+        if (objects != nullptr)
+            for (size_t i = 0; i < numObjects; i++)
+                new (objects + i) ObjectType();
+        return objects;
+    }
+
+    //==============================================================================
+    size_t getSize() const { return m_size; };
+    size_t getNumUsed() const { return m_numUsed; };
+    bool isLocked() const { return m_isLocked; };
+
+    //==============================================================================
+    static size_t getPaddedSize(size_t numFloats);
+    template <typename ObjectType>
+    static size_t getSizeForObjects(size_t numObjects)
+    {
+        return getPaddedSize((numObjects * sizeof(ObjectType) + sizeof(float) - 1) / sizeof(float));
+    }
+
+    static constexpr size_t s_alignment = 64;
+
+private:
+    void lockMemory();
+    void unlockMemory();
+
+    HeapBlock<char> m_memory;
+    float*          m_data{ nullptr };
+    size_t          m_size{ 0 };
+    size_t          m_numUsed{ 0 };
+    bool            m_isLocked{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioMemoryArena)
+};
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,42 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Denormal handling of recursive render state. FTZ/DAZ is only set on the
+ * threads that render, so feedback loops additionally snap their decaying
+ * state to zero below s_denormalFlushThreshold. That keeps them out of
+ * denormals with or without FTZ, and lets a silent loop settle on exact zeros.
+ */
+static constexpr float s_denormalFlushThreshold = 1e-15f; // -300dB, far below the float noise floor of any rendered signal
+
+// the value, or zero once it decayed below s_denormalFlushThreshold. A select, so it vectorizes in loops over many states.
+inline float flushDenormal(float value)
+{
+    return std::abs(value) < s_denormalFlushThreshold ? 0.0f : value;
+}
+
+} // namespace SurroundFieldMixer
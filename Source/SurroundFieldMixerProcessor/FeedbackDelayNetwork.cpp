@@ -0,0 +1,177 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FeedbackDelayNetwork.h"
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+FeedbackDelayNetwork::FeedbackDelayNetwork()
+{
+	for (auto column = 0; column < s_numLines; column++)
+	{
+		for (auto row = 0; row < s_numLines; row++)
+			m_feedbackMatrix[column * s_numLines + row] = getHadamardGain(row, column);
+
+		// the send is spread over all lines with its own sign pattern, so it does not only excite one mode of the matrix
+		m_inputGains[column] = getHadamardGain(1, column);
+	}
+}
+
+FeedbackDelayNetwork::~FeedbackDelayNetwork()
+{
+}
+
+void FeedbackDelayNetwork::prepare(double sampleRate, AudioMemoryArena& memory)
+{
+	// the arena hands out zeroed memory, so the network starts silent
+	auto ringLength = getRingLength(sampleRate);
+	m_ring = memory.take(static_cast<size_t>(ringLength) * s_numLines);
+	m_ringMask = ringLength - 1;
+	m_writePos = 0;
+	if (m_ring == nullptr)
+	{
+		release();
+		return;
+	}
+
+	// every pass through a line takes its share of the 60dB decay, so all lines decay at the same rate
+	for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+	{
+		m_lineLengths[lineIdx] = jmax(1, roundToInt(s_lineLengths[lineIdx] * sampleRate / s_referenceSampleRate));
+		m_feedbackGains[lineIdx] = std::pow(10.0f, -3.0f * static_cast<float>(m_lineLengths[lineIdx]) / (s_decayTimeSeconds * static_cast<float>(sampleRate)));
+		m_dampingStates[lineIdx] = 0.0f;
+	}
+	m_dampingCoefficient = std::exp(-MathConstants<float>::twoPi * s_dampingFrequency / static_cast<float>(sampleRate));
+}
+
+void FeedbackDelayNetwork::release()
+{
+	m_ring = nullptr;
+	m_ringMask = 0;
+	m_writePos = 0;
+	for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+		m_dampingStates[lineIdx] = 0.0f;
+}
+
+template <typename SampleType>
+void FeedbackDelayNetwork::process(const SampleType* input, SampleType* const* lineOutputs, int numSamples)
+{
+	if (m_ring == nullptr)
+	{
+		for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+			FloatVectorOperations::clear(lineOutputs[lineIdx], numSamples);
+		return;
+	}
+
+	alignas(64) float delayed[s_numLines];
+	alignas(64) float feedback[s_numLines];
+	auto damping = m_dampingCoefficient;
+
+	for (auto i = 0; i < numSamples; i++)
+	{
+		// the lines have different lengths, reading the delayed samples is the only step that does not work on all lines at once
+		for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+			delayed[lineIdx] = m_ring[static_cast<size_t>((m_writePos - m_lineLengths[lineIdx]) & m_ringMask) * s_numLines + lineIdx];
+		for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+			lineOutputs[lineIdx][i] = static_cast<SampleType>(delayed[lineIdx]);
+
+		// the lowpass state and everything written back into the ring is snapped to zero once it decayed below the threshold,
+		// a select over all lines that vectorizes like the rest of the loop
+		for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+		{
+			auto state = delayed[lineIdx] + damping * (m_dampingStates[lineIdx] - delayed[lineIdx]);
+			m_dampingStates[lineIdx] = flushDenormal(state);
+			feedback[lineIdx] = 0.0f;
+		}
+
+		// the matrix is applied as a sum of its scaled columns, every step is a multiply add over all lines
+		for (auto column = 0; column < s_numLines; column++)
+		{
+			auto x = m_dampingStates[column] * m_feedbackGains[column];
+			auto matrixColumn = m_feedbackMatrix + column * s_numLines;
+			for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+				feedback[lineIdx] += matrixColumn[lineIdx] * x;
+		}
+
+		auto in = static_cast<float>(input[i]);
+		auto slot = m_ring + static_cast<size_t>(m_writePos) * s_numLines;
+		for (auto lineIdx = 0; lineIdx < s_numLines; lineIdx++)
+		{
+			auto value = feedback[lineIdx] + m_inputGains[lineIdx] * in;
+			slot[lineIdx] = flushDenormal(value);
+		}
+
+		m_writePos = (m_writePos + 1) & m_ringMask;
+	}
+}
+
+template void FeedbackDelayNetwork::process<float>(const float* input, float* const* lineOutputs, int numSamples);
+template void FeedbackDelayNetwork::process<double>(const double* input, double* const* lineOutputs, int numSamples);
+
+float FeedbackDelayNetwork::getOutputTapGain(int outputIdx, int lineIdx)
+{
+	// every group of sixteen outputs takes the rows of the Hadamard matrix, which keeps the outputs within a group orthogonal.
+	// The groups differ by a sign per line, given by a quadratic function of the line index bits (one bit per product of two index bits).
+	// Quadratic functions are never affine, so the patterns of two groups are never Hadamard rows of each other:
+	// outputs of different groups correlate by at most 0.25 for the first 64 outputs and 0.5 up to 256.
+	static constexpr int groupSignMasks[] = { 0, 12, 22, 26, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 13 };
+	static constexpr int numGroups = static_cast<int>(sizeof(groupSignMasks) / sizeof(groupSignMasks[0]));
+
+	auto signMask = groupSignMasks[(outputIdx / s_numLines) % numGroups];
+	auto isFlipped = 0;
+	auto pairIdx = 0;
+	for (auto i = 0; i < 4; i++)
+	{
+		for (auto j = i + 1; j < 4; j++, pairIdx++)
+			isFlipped ^= ((signMask >> pairIdx) & 1) & ((lineIdx >> i) & 1) & ((lineIdx >> j) & 1);
+	}
+
+	auto gain = getHadamardGain(outputIdx % s_numLines, lineIdx);
+	return isFlipped ? -gain : gain;
+}
+
+int FeedbackDelayNetwork::getTailLengthInSamples(double sampleRate)
+{
+	// -120dB
+	return static_cast<int>(std::ceil(2.0 * s_decayTimeSeconds * sampleRate));
+}
+
+size_t FeedbackDelayNetwork::getRequiredMemorySize(double sampleRate)
+{
+	return AudioMemoryArena::getPaddedSize(static_cast<size_t>(getRingLength(sampleRate)) * s_numLines);
+}
+
+float FeedbackDelayNetwork::getHadamardGain(int row, int column)
+{
+	// Sylvester construction, the sign follows the parity of the common bits of row and column
+	auto sign = (countNumberOfBits(static_cast<uint32>(row & column)) & 1) ? -1.0f : 1.0f;
+	return sign / std::sqrt(static_cast<float>(s_numLines));
+}
+
+int FeedbackDelayNetwork::getRingLength(double sampleRate)
+{
+	auto maxLineLength = 0;
+	for (auto lineLength : s_lineLengths)
+		maxLineLength = jmax(maxLineLength, roundToInt(lineLength * sampleRate / s_referenceSampleRate));
+
+	return nextPowerOfTwo(maxLineLength + 1);
+}
+
+} // namespace SurroundFieldMixer
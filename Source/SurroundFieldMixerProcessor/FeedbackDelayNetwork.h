@@ -0,0 +1,89 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "AudioMemoryArena.h"
+#include "DenormalFlush.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Reverb engine of the shared reverb send bus. Sixteen delay lines of mutually
+ * prime lengths are fed back through an orthogonal Hadamard matrix, with a one
+ * pole lowpass per line so high frequencies decay faster than low ones.
+ * Sixteen lines give every speaker of the fixed layouts its own orthogonal
+ * combination of the lines.
+ * The line states of one sample are kept next to each other in a single
+ * interleaved ring, so apart from reading the delayed samples every step of
+ * the feedback loop is one pass over all lines at once, which vectorizes
+ * across the lines.
+ * The loop state is flushed with flushDenormal (see DenormalFlush.h).
+ */
+class FeedbackDelayNetwork
+{
+public:
+    FeedbackDelayNetwork();
+    ~FeedbackDelayNetwork();
+
+    //==============================================================================
+    void prepare(double sampleRate, AudioMemoryArena& memory);
+    void release();
+
+    //==============================================================================
+    // feeds one block of the mono send signal into the network and returns the block of every line, channels are processed in single precision
+    template <typename SampleType>
+    void process(const SampleType* input, SampleType* const* lineOutputs, int numSamples);
+
+    //==============================================================================
+    // gain of a line on an output. Groups of sixteen outputs get orthogonal sign patterns of the lines, different groups only correlate weakly.
+    static float getOutputTapGain(int outputIdx, int lineIdx);
+    static int getTailLengthInSamples(double sampleRate);
+
+    static size_t getRequiredMemorySize(double sampleRate);
+
+    static constexpr int s_numLines = 16;
+    static constexpr int s_lineLengths[s_numLines] = { 1009, 1123, 1249, 1361, 1481, 1597, 1733, 1861, 1993, 2129, 2273, 2411, 2551, 2699, 2843, 2999 }; // prime, 21ms to 62ms at the reference rate
+    static constexpr double s_referenceSampleRate = 48000.0;
+    static constexpr float s_decayTimeSeconds = 1.8f; // time to decay by 60dB
+    static constexpr float s_dampingFrequency = 6000.0f;
+
+private:
+    static float getHadamardGain(int row, int column);
+    static int getRingLength(double sampleRate);
+
+    float*              m_ring{ nullptr };      // ring length x lines, interleaved by line
+    int                 m_ringMask{ 0 };
+    int                 m_writePos{ 0 };
+    int                 m_lineLengths[s_numLines]{};
+
+    alignas(64) float   m_feedbackGains[s_numLines]{};
+    alignas(64) float   m_inputGains[s_numLines]{};
+    alignas(64) float   m_dampingStates[s_numLines]{};
+    alignas(64) float   m_feedbackMatrix[s_numLines * s_numLines]{};   // column major
+    float               m_dampingCoefficient{ 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FeedbackDelayNetwork)
+};
+
+} // namespace SurroundFieldMixer
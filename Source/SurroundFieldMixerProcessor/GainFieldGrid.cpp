@@ -0,0 +1,160 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "GainFieldGrid.h"
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+GainFieldGrid::GainFieldGrid(int resolution, int numGains)
+	: m_resolution(jmax(2, resolution)), m_numGains(jmax(0, numGains))
+{
+	m_gains.assign(static_cast<size_t>(m_resolution) * m_resolution * m_numGains, 0.0f);
+}
+
+GainFieldGrid::~GainFieldGrid()
+{
+}
+
+bool GainFieldGrid::build(const GainFunction& gainFunction, const std::function<bool()>& shouldAbort)
+{
+	auto step = 1.0f / static_cast<float>(m_resolution - 1);
+	for (auto yIdx = 0; yIdx < m_resolution; yIdx++)
+	{
+		if (shouldAbort && shouldAbort())
+			return false;
+
+		for (auto xIdx = 0; xIdx < m_resolution; xIdx++)
+		{
+			auto row = m_gains.data() + (static_cast<size_t>(yIdx) * m_resolution + xIdx) * m_numGains;
+			gainFunction(juce::Point<float>(static_cast<float>(xIdx) * step, static_cast<float>(yIdx) * step), row, m_numGains);
+		}
+	}
+
+	return true;
+}
+
+void GainFieldGrid::lookupGains(const juce::Point<float>& position, float* gains, int numGains) const
+{
+	// positions outside of the field get the gains of the nearest field edge
+	auto x = jlimit(0.0f, 1.0f, position.getX()) * static_cast<float>(m_resolution - 1);
+	auto y = jlimit(0.0f, 1.0f, position.getY()) * static_cast<float>(m_resolution - 1);
+	auto xIdx = jmin(static_cast<int>(x), m_resolution - 2);
+	auto yIdx = jmin(static_cast<int>(y), m_resolution - 2);
+	auto xFraction = x - static_cast<float>(xIdx);
+	auto yFraction = y - static_cast<float>(yIdx);
+
+	auto numGridGains = jmin(numGains, m_numGains);
+	FloatVectorOperations::copyWithMultiply(gains, getRow(xIdx, yIdx), (1.0f - xFraction) * (1.0f - yFraction), numGridGains);
+	FloatVectorOperations::addWithMultiply(gains, getRow(xIdx + 1, yIdx), xFraction * (1.0f - yFraction), numGridGains);
+	FloatVectorOperations::addWithMultiply(gains, getRow(xIdx, yIdx + 1), (1.0f - xFraction) * yFraction, numGridGains);
+	FloatVectorOperations::addWithMultiply(gains, getRow(xIdx + 1, yIdx + 1), xFraction * yFraction, numGridGains);
+
+	if (numGains > numGridGains)
+		FloatVectorOperations::clear(gains + numGridGains, numGains - numGridGains);
+}
+
+//==============================================================================
+GainFieldGridBuilder::GainFieldGridBuilder()
+	: Thread("GainFieldGridBuilder")
+{
+}
+
+GainFieldGridBuilder::~GainFieldGridBuilder()
+{
+	stop();
+}
+
+void GainFieldGridBuilder::setBuildCallback(const BuildCallback& callback)
+{
+	const ScopedLock sl(m_requestLock);
+	m_buildCallback = callback;
+}
+
+void GainFieldGridBuilder::requestBuild(int resolution, int numGains, const GainFieldGrid::GainFunction& gainFunction, uint32 requestId)
+{
+	{
+		const ScopedLock sl(m_requestLock);
+		m_pendingResolution = resolution;
+		m_pendingNumGains = numGains;
+		m_pendingGainFunction = gainFunction;
+		m_pendingRequestId = requestId;
+		m_isRequestPending = true;
+	}
+
+	// started on first use only, most setups never switch the grid on
+	if (!isThreadRunning())
+		startThread(Thread::Priority::low);
+	else
+		notify();
+}
+
+void GainFieldGridBuilder::stop()
+{
+	stopThread(1000);
+}
+
+void GainFieldGridBuilder::run()
+{
+	while (!threadShouldExit())
+	{
+		GainFieldGrid::GainFunction gainFunction;
+		auto resolution = 0;
+		auto numGains = 0;
+		uint32 requestId = 0;
+		{
+			const ScopedLock sl(m_requestLock);
+			if (m_isRequestPending)
+			{
+				gainFunction = std::move(m_pendingGainFunction);
+				resolution = m_pendingResolution;
+				numGains = m_pendingNumGains;
+				requestId = m_pendingRequestId;
+				m_isRequestPending = false;
+			}
+		}
+
+		if (!gainFunction)
+		{
+			wait(-1);
+			continue;
+		}
+
+		// a newer request makes this grid obsolete, it is dropped and the loop picks up the new one
+		auto grid = std::make_unique<GainFieldGrid>(resolution, numGains);
+		if (!grid->build(gainFunction, [this] { return threadShouldExit() || hasPendingRequest(); }))
+			continue;
+
+		BuildCallback callback;
+		{
+			const ScopedLock sl(m_requestLock);
+			callback = m_buildCallback;
+		}
+		if (callback)
+			callback(std::move(grid), requestId);
+	}
+}
+
+bool GainFieldGridBuilder::hasPendingRequest()
+{
+	const ScopedLock sl(m_requestLock);
+	return m_isRequestPending;
+}
+
+} // namespace SurroundFieldMixer
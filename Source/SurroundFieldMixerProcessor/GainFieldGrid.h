@@ -0,0 +1,106 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Precomputed per speaker gains of an arbitrary panning law, sampled on a
+ * regular grid over the normalized 0..1 field. Looking up the gains of a
+ * position bilinearly interpolates the four surrounding grid points, which
+ * costs the same for every panning law and every position.
+ * Grid points keep all their gains in one contiguous row.
+ */
+class GainFieldGrid
+{
+public:
+    using GainFunction = std::function<void(const juce::Point<float>& position, float* gains, int numGains)>;
+
+public:
+    GainFieldGrid(int resolution, int numGains);
+    ~GainFieldGrid();
+
+    //==============================================================================
+    // samples the gain function on every grid point, returns false if shouldAbort asked to stop before the grid was complete
+    bool build(const GainFunction& gainFunction, const std::function<bool()>& shouldAbort);
+
+    //==============================================================================
+    void lookupGains(const juce::Point<float>& position, float* gains, int numGains) const;
+
+    //==============================================================================
+    int getResolution() const { return m_resolution; };
+    int getNumGains() const { return m_numGains; };
+
+    //==============================================================================
+    static constexpr int s_defaultResolution = 65; // grid points per field edge, 1/64 field edge spacing
+
+private:
+    const float* getRow(int xIdx, int yIdx) const { return m_gains.data() + (static_cast<size_t>(yIdx) * m_resolution + xIdx) * m_numGains; };
+
+    int                 m_resolution{ 0 };
+    int                 m_numGains{ 0 };
+    std::vector<float>  m_gains;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GainFieldGrid)
+};
+
+//==============================================================================
+/*
+ * Low priority background thread that builds GainFieldGrids on request, so
+ * a speaker layout or panning law change does not hold up the control side.
+ * A request that comes in while a grid is still being built abandons that
+ * grid, only the most recent request is completed and handed to the callback.
+ * The callback is invoked on the builder thread.
+ */
+class GainFieldGridBuilder : private Thread
+{
+public:
+    using BuildCallback = std::function<void(std::unique_ptr<GainFieldGrid> grid, uint32 requestId)>;
+
+public:
+    GainFieldGridBuilder();
+    ~GainFieldGridBuilder() override;
+
+    //==============================================================================
+    void setBuildCallback(const BuildCallback& callback);
+    void requestBuild(int resolution, int numGains, const GainFieldGrid::GainFunction& gainFunction, uint32 requestId);
+    void stop();
+
+private:
+    void run() override;
+    bool hasPendingRequest();
+
+    CriticalSection             m_requestLock;
+    GainFieldGrid::GainFunction m_pendingGainFunction;
+    int                         m_pendingResolution{ 0 };
+    int                         m_pendingNumGains{ 0 };
+    uint32                      m_pendingRequestId{ 0 };
+    bool                        m_isRequestPending{ false };
+
+    BuildCallback               m_buildCallback;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GainFieldGridBuilder)
+};
+
+} // namespace SurroundFieldMixer
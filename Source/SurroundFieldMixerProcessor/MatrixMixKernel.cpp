@@ -0,0 +1,486 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MatrixMixKernel.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+#if JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+// avx2 code is compiled into the otherwise baseline targeted binary and only called when the cpu supports it
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define SURROUNDFIELDMIXER_AVX2_TARGET __attribute__((target("avx2,fma")))
+#else
+ #define SURROUNDFIELDMIXER_AVX2_TARGET
+#endif
+
+namespace SurroundFieldMixer
+{
+
+namespace
+{
+
+//==============================================================================
+// also used as the double precision path, the compiler vectorizes it with the baseline instruction set
+template <typename SampleType>
+struct ScalarGroupMixer
+{
+	template <int NumOutputs>
+	static void mix(const SampleType* input, SampleType* const* outputs, const float* gains, int numSamples)
+	{
+		SampleType* out[NumOutputs];
+		SampleType g[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			g[j] = gains[j];
+		}
+
+		for (auto i = 0; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * g[j];
+		}
+	}
+
+	template <int NumOutputs>
+	static void mixRamped(const SampleType* input, SampleType* const* outputs, const float* startGains, const float* endGains, int numSamples)
+	{
+		SampleType* out[NumOutputs];
+		SampleType g[NumOutputs];
+		SampleType inc[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			g[j] = startGains[j];
+			inc[j] = (static_cast<SampleType>(endGains[j]) - startGains[j]) / numSamples;
+		}
+
+		for (auto i = 0; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+			{
+				out[j][i] += x * g[j];
+				g[j] += inc[j];
+			}
+		}
+	}
+};
+
+#if JUCE_INTEL
+//==============================================================================
+struct SSEGroupMixer
+{
+	template <int NumOutputs>
+	static void mix(const float* input, float* const* outputs, const float* gains, int numSamples)
+	{
+		float* out[NumOutputs];
+		__m128 g[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			g[j] = _mm_set1_ps(gains[j]);
+		}
+
+		auto i = 0;
+		for (; i + 4 <= numSamples; i += 4)
+		{
+			auto x = _mm_loadu_ps(input + i);
+			for (auto j = 0; j < NumOutputs; j++)
+				_mm_storeu_ps(out[j] + i, _mm_add_ps(_mm_loadu_ps(out[j] + i), _mm_mul_ps(x, g[j])));
+		}
+		for (; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * gains[j];
+		}
+	}
+
+	template <int NumOutputs>
+	static void mixRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numSamples)
+	{
+		float* out[NumOutputs];
+		float inc[NumOutputs];
+		__m128 g[NumOutputs];
+		__m128 step[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			inc[j] = (endGains[j] - startGains[j]) / numSamples;
+			g[j] = _mm_add_ps(_mm_set1_ps(startGains[j]), _mm_mul_ps(_mm_set1_ps(inc[j]), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)));
+			step[j] = _mm_set1_ps(4.0f * inc[j]);
+		}
+
+		auto i = 0;
+		for (; i + 4 <= numSamples; i += 4)
+		{
+			auto x = _mm_loadu_ps(input + i);
+			for (auto j = 0; j < NumOutputs; j++)
+			{
+				_mm_storeu_ps(out[j] + i, _mm_add_ps(_mm_loadu_ps(out[j] + i), _mm_mul_ps(x, g[j])));
+				g[j] = _mm_add_ps(g[j], step[j]);
+			}
+		}
+		for (; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * (startGains[j] + inc[j] * i);
+		}
+	}
+};
+
+//==============================================================================
+struct AVX2GroupMixer
+{
+	template <int NumOutputs>
+	SURROUNDFIELDMIXER_AVX2_TARGET static void mix(const float* input, float* const* outputs, const float* gains, int numSamples)
+	{
+		float* out[NumOutputs];
+		__m256 g[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			g[j] = _mm256_set1_ps(gains[j]);
+		}
+
+		auto i = 0;
+		for (; i + 8 <= numSamples; i += 8)
+		{
+			auto x = _mm256_loadu_ps(input + i);
+			for (auto j = 0; j < NumOutputs; j++)
+				_mm256_storeu_ps(out[j] + i, _mm256_fmadd_ps(x, g[j], _mm256_loadu_ps(out[j] + i)));
+		}
+		for (; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * gains[j];
+		}
+	}
+
+	template <int NumOutputs>
+	SURROUNDFIELDMIXER_AVX2_TARGET static void mixRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numSamples)
+	{
+		float* out[NumOutputs];
+		float inc[NumOutputs];
+		__m256 g[NumOutputs];
+		__m256 step[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			inc[j] = (endGains[j] - startGains[j]) / numSamples;
+			g[j] = _mm256_fmadd_ps(_mm256_set1_ps(inc[j]), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f), _mm256_set1_ps(startGains[j]));
+			step[j] = _mm256_set1_ps(8.0f * inc[j]);
+		}
+
+		auto i = 0;
+		for (; i + 8 <= numSamples; i += 8)
+		{
+			auto x = _mm256_loadu_ps(input + i);
+			for (auto j = 0; j < NumOutputs; j++)
+			{
+				_mm256_storeu_ps(out[j] + i, _mm256_fmadd_ps(x, g[j], _mm256_loadu_ps(out[j] + i)));
+				g[j] = _mm256_add_ps(g[j], step[j]);
+			}
+		}
+		for (; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * (startGains[j] + inc[j] * i);
+		}
+	}
+};
+#endif
+
+#if JUCE_USE_ARM_NEON
+//==============================================================================
+struct NEONGroupMixer
+{
+	template <int NumOutputs>
+	static void mix(const float* input, float* const* outputs, const float* gains, int numSamples)
+	{
+		float* out[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+			out[j] = outputs[j];
+
+		auto i = 0;
+		for (; i + 4 <= numSamples; i += 4)
+		{
+			auto x = vld1q_f32(input + i);
+			for (auto j = 0; j < NumOutputs; j++)
+				vst1q_f32(out[j] + i, vmlaq_n_f32(vld1q_f32(out[j] + i), x, gains[j]));
+		}
+		for (; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * gains[j];
+		}
+	}
+
+	template <int NumOutputs>
+	static void mixRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numSamples)
+	{
+		static const float rampOffsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+
+		float* out[NumOutputs];
+		float inc[NumOutputs];
+		float32x4_t g[NumOutputs];
+		float32x4_t step[NumOutputs];
+		for (auto j = 0; j < NumOutputs; j++)
+		{
+			out[j] = outputs[j];
+			inc[j] = (endGains[j] - startGains[j]) / numSamples;
+			g[j] = vmlaq_n_f32(vdupq_n_f32(startGains[j]), vld1q_f32(rampOffsets), inc[j]);
+			step[j] = vdupq_n_f32(4.0f * inc[j]);
+		}
+
+		auto i = 0;
+		for (; i + 4 <= numSamples; i += 4)
+		{
+			auto x = vld1q_f32(input + i);
+			for (auto j = 0; j < NumOutputs; j++)
+			{
+				vst1q_f32(out[j] + i, vmlaq_f32(vld1q_f32(out[j] + i), x, g[j]));
+				g[j] = vaddq_f32(g[j], step[j]);
+			}
+		}
+		for (; i < numSamples; i++)
+		{
+			auto x = input[i];
+			for (auto j = 0; j < NumOutputs; j++)
+				out[j][i] += x * (startGains[j] + inc[j] * i);
+		}
+	}
+};
+#endif
+
+//==============================================================================
+template <typename GroupMixer, typename SampleType = float>
+void mixInGroups(const SampleType* input, SampleType* const* outputs, const float* gains, int numOutputs, int numSamples)
+{
+	auto outputIdx = 0;
+	for (; outputIdx + MatrixMixKernel::s_outputsPerPass <= numOutputs; outputIdx += MatrixMixKernel::s_outputsPerPass)
+		GroupMixer::template mix<MatrixMixKernel::s_outputsPerPass>(input, outputs + outputIdx, gains + outputIdx, numSamples);
+
+	switch (numOutputs - outputIdx)
+	{
+	case 3:
+		GroupMixer::template mix<3>(input, outputs + outputIdx, gains + outputIdx, numSamples);
+		break;
+	case 2:
+		GroupMixer::template mix<2>(input, outputs + outputIdx, gains + outputIdx, numSamples);
+		break;
+	case 1:
+		GroupMixer::template mix<1>(input, outputs + outputIdx, gains + outputIdx, numSamples);
+		break;
+	default:
+		break;
+	}
+}
+
+template <typename GroupMixer, typename SampleType = float>
+void mixRampedInGroups(const SampleType* input, SampleType* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples)
+{
+	auto outputIdx = 0;
+	for (; outputIdx + MatrixMixKernel::s_outputsPerPass <= numOutputs; outputIdx += MatrixMixKernel::s_outputsPerPass)
+		GroupMixer::template mixRamped<MatrixMixKernel::s_outputsPerPass>(input, outputs + outputIdx, startGains + outputIdx, endGains + outputIdx, numSamples);
+
+	switch (numOutputs - outputIdx)
+	{
+	case 3:
+		GroupMixer::template mixRamped<3>(input, outputs + outputIdx, startGains + outputIdx, endGains + outputIdx, numSamples);
+		break;
+	case 2:
+		GroupMixer::template mixRamped<2>(input, outputs + outputIdx, startGains + outputIdx, endGains + outputIdx, numSamples);
+		break;
+	case 1:
+		GroupMixer::template mixRamped<1>(input, outputs + outputIdx, startGains + outputIdx, endGains + outputIdx, numSamples);
+		break;
+	default:
+		break;
+	}
+}
+
+template <typename GroupMixer, typename SampleType = float>
+void mixInSinglePass(const SampleType* input, SampleType* const* outputs, const float* gains, int numOutputs, int numSamples)
+{
+	switch (numOutputs)
+	{
+	case 5:
+		GroupMixer::template mix<5>(input, outputs, gains, numSamples);
+		break;
+	case 6:
+		GroupMixer::template mix<6>(input, outputs, gains, numSamples);
+		break;
+	case 8:
+		GroupMixer::template mix<8>(input, outputs, gains, numSamples);
+		break;
+	case 12:
+		GroupMixer::template mix<12>(input, outputs, gains, numSamples);
+		break;
+	default:
+		mixInGroups<GroupMixer, SampleType>(input, outputs, gains, numOutputs, numSamples);
+		break;
+	}
+}
+
+template <typename GroupMixer, typename SampleType = float>
+void mixRampedInSinglePass(const SampleType* input, SampleType* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples)
+{
+	switch (numOutputs)
+	{
+	case 5:
+		GroupMixer::template mixRamped<5>(input, outputs, startGains, endGains, numSamples);
+		break;
+	case 6:
+		GroupMixer::template mixRamped<6>(input, outputs, startGains, endGains, numSamples);
+		break;
+	case 8:
+		GroupMixer::template mixRamped<8>(input, outputs, startGains, endGains, numSamples);
+		break;
+	case 12:
+		GroupMixer::template mixRamped<12>(input, outputs, startGains, endGains, numSamples);
+		break;
+	default:
+		mixRampedInGroups<GroupMixer, SampleType>(input, outputs, startGains, endGains, numOutputs, numSamples);
+		break;
+	}
+}
+
+} // namespace
+
+//==============================================================================
+MatrixMixKernel::MatrixMixKernel()
+{
+	m_instructionSet = InstructionSet::Scalar;
+	m_mixFunction = mixInGroups<ScalarGroupMixer<float>>;
+	m_rampedMixFunction = mixRampedInGroups<ScalarGroupMixer<float>>;
+	m_layoutMixFunction = mixInSinglePass<ScalarGroupMixer<float>>;
+	m_rampedLayoutMixFunction = mixRampedInSinglePass<ScalarGroupMixer<float>>;
+
+#if JUCE_INTEL
+	if (SystemStats::hasAVX2() && SystemStats::hasFMA3())
+	{
+		m_instructionSet = InstructionSet::AVX2;
+		m_mixFunction = mixInGroups<AVX2GroupMixer>;
+		m_rampedMixFunction = mixRampedInGroups<AVX2GroupMixer>;
+		m_layoutMixFunction = mixInSinglePass<AVX2GroupMixer>;
+		m_rampedLayoutMixFunction = mixRampedInSinglePass<AVX2GroupMixer>;
+	}
+	else if (SystemStats::hasSSE2())
+	{
+		m_instructionSet = InstructionSet::SSE;
+		m_mixFunction = mixInGroups<SSEGroupMixer>;
+		m_rampedMixFunction = mixRampedInGroups<SSEGroupMixer>;
+		m_layoutMixFunction = mixInSinglePass<SSEGroupMixer>;
+		m_rampedLayoutMixFunction = mixRampedInSinglePass<SSEGroupMixer>;
+	}
+#elif JUCE_USE_ARM_NEON
+	if (SystemStats::hasNeon())
+	{
+		m_instructionSet = InstructionSet::NEON;
+		m_mixFunction = mixInGroups<NEONGroupMixer>;
+		m_rampedMixFunction = mixRampedInGroups<NEONGroupMixer>;
+		m_layoutMixFunction = mixInSinglePass<NEONGroupMixer>;
+		m_rampedLayoutMixFunction = mixRampedInSinglePass<NEONGroupMixer>;
+	}
+#endif
+}
+
+MatrixMixKernel::~MatrixMixKernel()
+{
+}
+
+String MatrixMixKernel::getInstructionSetName(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::SSE:
+		return "SSE";
+	case InstructionSet::AVX2:
+		return "AVX2";
+	case InstructionSet::NEON:
+		return "NEON";
+	case InstructionSet::Scalar:
+	default:
+		return "Scalar";
+	}
+}
+
+void MatrixMixKernel::mixInputToOutputs(const float* input, float* const* outputs, const float* gains, int numOutputs, int numSamples) const
+{
+	m_mixFunction(input, outputs, gains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToOutputsRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const
+{
+	if (numSamples <= 0)
+		return;
+
+	m_rampedMixFunction(input, outputs, startGains, endGains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToLayoutOutputs(const float* input, float* const* outputs, const float* gains, int numOutputs, int numSamples) const
+{
+	m_layoutMixFunction(input, outputs, gains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToLayoutOutputsRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const
+{
+	if (numSamples <= 0)
+		return;
+
+	m_rampedLayoutMixFunction(input, outputs, startGains, endGains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToOutputs(const double* input, double* const* outputs, const float* gains, int numOutputs, int numSamples) const
+{
+	mixInGroups<ScalarGroupMixer<double>, double>(input, outputs, gains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToOutputsRamped(const double* input, double* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const
+{
+	if (numSamples <= 0)
+		return;
+
+	mixRampedInGroups<ScalarGroupMixer<double>, double>(input, outputs, startGains, endGains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToLayoutOutputs(const double* input, double* const* outputs, const float* gains, int numOutputs, int numSamples) const
+{
+	mixInSinglePass<ScalarGroupMixer<double>, double>(input, outputs, gains, numOutputs, numSamples);
+}
+
+void MatrixMixKernel::mixInputToLayoutOutputsRamped(const double* input, double* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const
+{
+	if (numSamples <= 0)
+		return;
+
+	mixRampedInSinglePass<ScalarGroupMixer<double>, double>(input, outputs, startGains, endGains, numOutputs, numSamples);
+}
+
+} // namespace SurroundFieldMixer
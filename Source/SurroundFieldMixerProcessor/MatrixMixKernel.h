@@ -0,0 +1,86 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Summing stage of the processing matrix. One input block is added into
+ * several outputs per pass, so the input samples are only loaded once for
+ * each group of outputs instead of once per input/output pair.
+ * The implementation is picked at construction time from the instruction
+ * sets available on the running cpu.
+ */
+class MatrixMixKernel
+{
+public:
+    enum InstructionSet
+    {
+        Scalar,
+        SSE,
+        AVX2,
+        NEON,
+    };
+
+public:
+    MatrixMixKernel();
+    ~MatrixMixKernel();
+
+    //==============================================================================
+    InstructionSet getInstructionSet() const { return m_instructionSet; };
+    static String getInstructionSetName(InstructionSet instructionSet);
+
+    //==============================================================================
+    void mixInputToOutputs(const float* input, float* const* outputs, const float* gains, int numOutputs, int numSamples) const;
+    // gains move linearly from startGains to endGains over the block, to avoid zipper noise on changes
+    void mixInputToOutputsRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const;
+
+    // all outputs in a single pass over the input, unrolled for the output counts of the fixed speaker layouts (5, 6, 8, 12).
+    // Other output counts fall back to the grouped mix above.
+    void mixInputToLayoutOutputs(const float* input, float* const* outputs, const float* gains, int numOutputs, int numSamples) const;
+    void mixInputToLayoutOutputsRamped(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const;
+
+    // double precision variants of the above, gains stay single precision
+    void mixInputToOutputs(const double* input, double* const* outputs, const float* gains, int numOutputs, int numSamples) const;
+    void mixInputToOutputsRamped(const double* input, double* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const;
+    void mixInputToLayoutOutputs(const double* input, double* const* outputs, const float* gains, int numOutputs, int numSamples) const;
+    void mixInputToLayoutOutputsRamped(const double* input, double* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples) const;
+
+    //==============================================================================
+    static constexpr int s_outputsPerPass = 4;
+
+private:
+    using MixFunction = void (*)(const float* input, float* const* outputs, const float* gains, int numOutputs, int numSamples);
+    using RampedMixFunction = void (*)(const float* input, float* const* outputs, const float* startGains, const float* endGains, int numOutputs, int numSamples);
+
+    InstructionSet      m_instructionSet{ InstructionSet::Scalar };
+    MixFunction         m_mixFunction{ nullptr };
+    RampedMixFunction   m_rampedMixFunction{ nullptr };
+    MixFunction         m_layoutMixFunction{ nullptr };
+    RampedMixFunction   m_rampedLayoutMixFunction{ nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MatrixMixKernel)
+};
+
+} // namespace SurroundFieldMixer
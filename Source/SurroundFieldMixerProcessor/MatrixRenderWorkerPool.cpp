@@ -0,0 +1,311 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "MatrixRenderWorkerPool.h"
+
+#if JUCE_LINUX
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#elif JUCE_WINDOWS
+ // declared here instead of including windows.h, which clashes with the juce namespace
+ extern "C" __declspec(dllimport) int __stdcall WaitOnAddress(volatile void* address, void* compareAddress, size_t addressSize, unsigned long milliseconds);
+ extern "C" __declspec(dllimport) void __stdcall WakeByAddressAll(void* address);
+ #pragma comment(lib, "Synchronization.lib")
+#endif
+
+namespace SurroundFieldMixer
+{
+
+namespace
+{
+
+//==============================================================================
+/*
+ * Futex style sleeping on a 32 bit word. The sleeper only goes to sleep while
+ * the word still holds the expected value, waking never takes a lock.
+ * Without an os primitive for it the sleeper naps briefly and checks again.
+ */
+void waitOnWord(std::atomic<uint32>& word, uint32 expectedValue, int timeoutMs)
+{
+#if JUCE_LINUX
+	timespec timeout{ timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+	syscall(SYS_futex, reinterpret_cast<uint32*>(&word), FUTEX_WAIT_PRIVATE, expectedValue, &timeout, nullptr, 0);
+#elif JUCE_WINDOWS
+	WaitOnAddress(&word, &expectedValue, sizeof(expectedValue), static_cast<unsigned long>(timeoutMs));
+#else
+	if (word.load() == expectedValue)
+		Thread::sleep(1);
+	ignoreUnused(timeoutMs);
+#endif
+}
+
+void wakeAllOnWord(std::atomic<uint32>& word)
+{
+#if JUCE_LINUX
+	syscall(SYS_futex, reinterpret_cast<uint32*>(&word), FUTEX_WAKE_PRIVATE, std::numeric_limits<int>::max(), nullptr, nullptr, 0);
+#elif JUCE_WINDOWS
+	WakeByAddressAll(&word);
+#else
+	ignoreUnused(word);
+#endif
+}
+
+} // namespace
+
+//==============================================================================
+MatrixRenderWorkerPool::Worker::Worker(MatrixRenderWorkerPool& pool, int workerIdx)
+	: Thread("MatrixRenderWorker" + String(workerIdx)),
+	m_pool(pool),
+	m_slotIdx(workerIdx + 1)
+{
+}
+
+MatrixRenderWorkerPool::Worker::~Worker()
+{
+}
+
+void MatrixRenderWorkerPool::Worker::run()
+{
+	// the flush to zero mode is per thread, jobs rendered here have to see the same as the audio thread
+	ScopedNoDenormals noDenormals;
+
+	auto seenBatchId = getBatchId(m_pool.m_state.load());
+
+	while (!threadShouldExit())
+	{
+		// spin for a bounded time on the batch id, sleep afterwards to not burn a core while nothing is rendered
+		auto spinIterations = 0;
+		while (getBatchId(m_pool.m_state.load(std::memory_order_acquire)) == seenBatchId && !threadShouldExit())
+		{
+			if (++spinIterations < s_maxSpinIterations)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// the batch id is checked again after announcing the sleep, so a wake up in between is not missed.
+			// The word is read before that check, a batch published afterwards changes it and the wait returns right away.
+			auto wakeUpWord = m_pool.m_wakeUpWord.load();
+			m_pool.m_numSleepingWorkers.fetch_add(1);
+			if (getBatchId(m_pool.m_state.load()) == seenBatchId && !threadShouldExit())
+				waitOnWord(m_pool.m_wakeUpWord, wakeUpWord, s_maxSleepMs);
+			m_pool.m_numSleepingWorkers.fetch_sub(1);
+			spinIterations = 0;
+		}
+
+		seenBatchId = getBatchId(m_pool.m_state.load(std::memory_order_acquire));
+		m_pool.processJobs(m_slotIdx);
+	}
+}
+
+//==============================================================================
+MatrixRenderWorkerPool::MatrixRenderWorkerPool(int numWorkers, double sampleRate, int maxSamplesPerBlock)
+{
+	m_maxWaitTicks = Time::secondsToHighResolutionTicks(s_maxWaitBlockFraction * maxSamplesPerBlock / sampleRate);
+
+	// the workers share the audio thread's deadline, so they are scheduled like it where the os allows
+	auto realtimeOptions = Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(maxSamplesPerBlock, sampleRate);
+	for (auto i = 0; i < numWorkers; i++)
+	{
+		m_workers.push_back(std::make_unique<Worker>(*this, i));
+		if (!m_workers.back()->startRealtimeThread(realtimeOptions))
+			m_workers.back()->startThread(Thread::Priority::highest);
+	}
+}
+
+MatrixRenderWorkerPool::~MatrixRenderWorkerPool()
+{
+	for (auto& worker : m_workers)
+		worker->signalThreadShouldExit();
+	m_wakeUpWord.fetch_add(1);
+	wakeAllOnWord(m_wakeUpWord);
+	for (auto& worker : m_workers)
+		worker->stopThread(1000);
+}
+
+uint64 MatrixRenderWorkerPool::packState(uint32 batchId, int nextJob, int numJobs)
+{
+	return (static_cast<uint64>(batchId) << 32) | (static_cast<uint64>(nextJob & 0xffff) << 16) | static_cast<uint64>(numJobs & 0xffff);
+}
+
+uint64 MatrixRenderWorkerPool::packJobState(uint32 batchId, JobStatus status, int slotIdx)
+{
+	return (static_cast<uint64>(batchId) << 32) | (static_cast<uint64>(status) << 16) | static_cast<uint64>(slotIdx & 0xffff);
+}
+
+uint32 MatrixRenderWorkerPool::getBatchId(uint64 state)
+{
+	return static_cast<uint32>(state >> 32);
+}
+
+int MatrixRenderWorkerPool::getJobStatus(uint64 jobState)
+{
+	return static_cast<int>((jobState >> 16) & 0xffff);
+}
+
+void MatrixRenderWorkerPool::runJobs(JobFunction function, void* context, int numJobs, InlineFunction inlineFunction)
+{
+	jassert(numJobs <= s_maxNumJobs);
+	numJobs = jmin(numJobs, s_maxNumJobs);
+	if (numJobs <= 0)
+		return;
+
+	// after a missed deadline the workers are left out for a while, the batch is rendered right here
+	m_isBatchRenderedInline = m_fallbackBatchesLeft > 0;
+	if (m_isBatchRenderedInline)
+	{
+		m_fallbackBatchesLeft--;
+		if (inlineFunction != nullptr)
+			inlineFunction(context);
+		for (auto jobIdx = 0; jobIdx < numJobs; jobIdx++)
+			function(context, jobIdx, 0);
+		return;
+	}
+
+	// function and context are published together with the new batch state
+	auto batchId = ++m_batchId;
+	m_function.store(function, std::memory_order_relaxed);
+	m_context.store(context, std::memory_order_relaxed);
+	m_state.store(packState(batchId, 0, numJobs));
+
+	wakeUpWorkers();
+
+	if (inlineFunction != nullptr)
+		inlineFunction(context);
+
+	// every job no worker has picked up yet is rendered inline
+	processJobs(0);
+
+	// every job is claimed at this point, the ones still running on a worker are waited for until the deadline
+	auto deadline = Time::getHighResolutionTicks() + m_maxWaitTicks;
+	while (!areAllJobsDone(batchId, numJobs) && Time::getHighResolutionTicks() <= deadline)
+		std::this_thread::yield();
+
+	// whatever is not done by now is rendered here again, the callback never depends on a worker being scheduled
+	auto isDeadlineMissed = false;
+	for (auto jobIdx = 0; jobIdx < numJobs; jobIdx++)
+	{
+		if (takeOverJob(jobIdx, batchId))
+		{
+			isDeadlineMissed = true;
+			function(context, jobIdx, 0);
+		}
+	}
+
+	if (isDeadlineMissed)
+	{
+		m_numMissedDeadlines.fetch_add(1, std::memory_order_relaxed);
+		m_fallbackBatchesLeft = s_fallbackBatchCount;
+	}
+}
+
+int MatrixRenderWorkerPool::getJobSlot(int jobIdx) const
+{
+	if (m_isBatchRenderedInline || jobIdx < 0 || jobIdx >= s_maxNumJobs)
+		return 0;
+
+	// the jobs of the last batch are either done or taken over, late workers of older batches cannot change that
+	auto jobState = m_jobStates[jobIdx].load(std::memory_order_acquire);
+	if (getBatchId(jobState) != m_batchId || getJobStatus(jobState) != Done)
+		return 0;
+
+	return static_cast<int>(jobState & 0xffff);
+}
+
+void MatrixRenderWorkerPool::wakeUpWorkers()
+{
+	// the futex word changes with every batch, the os is only called while a worker is actually sleeping
+	m_wakeUpWord.store(m_batchId);
+	if (m_numSleepingWorkers.load() > 0)
+		wakeAllOnWord(m_wakeUpWord);
+}
+
+void MatrixRenderWorkerPool::processJobs(int slotIdx)
+{
+	auto state = m_state.load(std::memory_order_acquire);
+	while (true)
+	{
+		auto nextJob = static_cast<int>((state >> 16) & 0xffff);
+		auto numJobs = static_cast<int>(state & 0xffff);
+		if (nextJob >= numJobs)
+			return;
+
+		// claiming is tied to the batch id in the same word, so a late worker can never claim a job of a finished batch
+		if (!m_state.compare_exchange_weak(state, packState(getBatchId(state), nextJob + 1, numJobs), std::memory_order_acq_rel, std::memory_order_acquire))
+			continue;
+
+		auto batchId = getBatchId(state);
+		if (startJob(nextJob, batchId, slotIdx))
+		{
+			m_function.load(std::memory_order_relaxed)(m_context.load(std::memory_order_relaxed), nextJob, slotIdx);
+			finishJob(nextJob, batchId, slotIdx);
+		}
+
+		state = m_state.load(std::memory_order_acquire);
+	}
+}
+
+bool MatrixRenderWorkerPool::startJob(int jobIdx, uint32 batchId, int slotIdx)
+{
+	// the job state still belongs to an older batch unless the audio thread has taken the job over in the meantime
+	auto& jobState = m_jobStates[jobIdx];
+	auto state = jobState.load(std::memory_order_acquire);
+	while (getBatchId(state) != batchId)
+	{
+		if (jobState.compare_exchange_weak(state, packJobState(batchId, Claimed, slotIdx), std::memory_order_acq_rel, std::memory_order_acquire))
+			return true;
+	}
+
+	return false;
+}
+
+void MatrixRenderWorkerPool::finishJob(int jobIdx, uint32 batchId, int slotIdx)
+{
+	// fails if the audio thread has taken the job over, the result rendered here is dropped then
+	auto expected = packJobState(batchId, Claimed, slotIdx);
+	m_jobStates[jobIdx].compare_exchange_strong(expected, packJobState(batchId, Done, slotIdx), std::memory_order_release, std::memory_order_relaxed);
+}
+
+bool MatrixRenderWorkerPool::takeOverJob(int jobIdx, uint32 batchId)
+{
+	// every failed exchange means a worker has started or finished the job in between, so this settles after a few rounds
+	auto& jobState = m_jobStates[jobIdx];
+	auto state = jobState.load(std::memory_order_acquire);
+	while (!(getBatchId(state) == batchId && getJobStatus(state) == Done))
+	{
+		if (jobState.compare_exchange_weak(state, packJobState(batchId, TakenOver, 0), std::memory_order_acq_rel, std::memory_order_acquire))
+			return true;
+	}
+
+	return false;
+}
+
+bool MatrixRenderWorkerPool::areAllJobsDone(uint32 batchId, int numJobs) const
+{
+	for (auto jobIdx = 0; jobIdx < numJobs; jobIdx++)
+	{
+		auto state = m_jobStates[jobIdx].load(std::memory_order_acquire);
+		if (getBatchId(state) != batchId || getJobStatus(state) != Done)
+			return false;
+	}
+
+	return true;
+}
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,127 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Small pool of realtime worker threads the audio thread can hand
+ * independent parts of its render work to. The audio thread publishes a batch
+ * of jobs, does its own inline work, renders every job no worker has claimed
+ * yet and then waits a bounded time for the jobs still running on a worker.
+ * Job claiming is a single compare and swap on a packed batch/job state,
+ * nothing is locked or allocated. Idle workers spin for a short while and
+ * then sleep futex style on an atomic word, so waking them up never takes a
+ * lock on the audio thread.
+ * Every thread renders into the working memory of its own slot and jobs leave
+ * shared state alone, so a job can be rendered twice. A job that is still
+ * running on a worker at the deadline is taken over by the audio thread with
+ * a compare and swap on the job state and rendered again in slot 0, the
+ * result of the late worker is dropped. After a missed deadline the following
+ * batches are rendered inline for a while instead of being handed out.
+ */
+class MatrixRenderWorkerPool
+{
+public:
+    // slot 0 is the audio thread, slot n is worker n - 1
+    using JobFunction = void (*)(void* context, int jobIdx, int slotIdx);
+    using InlineFunction = void (*)(void* context);
+
+public:
+    MatrixRenderWorkerPool(int numWorkers, double sampleRate, int maxSamplesPerBlock);
+    ~MatrixRenderWorkerPool();
+
+    //==============================================================================
+    int getNumWorkers() const { return static_cast<int>(m_workers.size()); };
+    int getNumSlots() const { return getNumWorkers() + 1; };
+    int getNumMissedDeadlines() const { return m_numMissedDeadlines.load(); };
+
+    //==============================================================================
+    // the inline function is work only the audio thread may do, it runs while the workers render the first jobs
+    void runJobs(JobFunction function, void* context, int numJobs, InlineFunction inlineFunction = nullptr);
+    // slot the result of a job of the last batch was rendered in
+    int getJobSlot(int jobIdx) const;
+
+    //==============================================================================
+    static constexpr int s_maxNumJobs = 64;
+    static constexpr double s_maxWaitBlockFraction = 0.25; // share of a block the audio thread waits for running jobs before taking them over
+    static constexpr int s_fallbackBatchCount = 512; // batches rendered inline after a missed deadline, about 5s at 512 samples and 48kHz
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(MatrixRenderWorkerPool& pool, int workerIdx);
+        ~Worker() override;
+
+        void run() override;
+
+    private:
+        MatrixRenderWorkerPool& m_pool;
+        int                     m_slotIdx{ 0 };
+    };
+
+    enum JobStatus
+    {
+        Claimed = 1,
+        Done,
+        TakenOver,
+    };
+
+    //==============================================================================
+    static uint64 packState(uint32 batchId, int nextJob, int numJobs);
+    static uint64 packJobState(uint32 batchId, JobStatus status, int slotIdx);
+    static uint32 getBatchId(uint64 state);
+    static int getJobStatus(uint64 jobState);
+
+    void processJobs(int slotIdx);
+    bool startJob(int jobIdx, uint32 batchId, int slotIdx);
+    void finishJob(int jobIdx, uint32 batchId, int slotIdx);
+    bool takeOverJob(int jobIdx, uint32 batchId);
+    bool areAllJobsDone(uint32 batchId, int numJobs) const;
+    void wakeUpWorkers();
+
+    //==============================================================================
+    static constexpr int s_maxSpinIterations = 4000;
+    static constexpr int s_maxSleepMs = 5;
+
+    std::vector<std::unique_ptr<Worker>>    m_workers;
+
+    std::atomic<JobFunction>                m_function{ nullptr };
+    std::atomic<void*>                      m_context{ nullptr };
+    uint32                                  m_batchId{ 0 };
+    std::atomic<uint64>                     m_state{ 0 };           // batch id | next job | number of jobs
+    std::atomic<uint64>                     m_jobStates[s_maxNumJobs]{}; // batch id | status | slot, per job
+    bool                                    m_isBatchRenderedInline{ false };
+
+    std::atomic<uint32>                     m_wakeUpWord{ 0 };      // futex word the idle workers sleep on
+    std::atomic<int>                        m_numSleepingWorkers{ 0 };
+    int64                                   m_maxWaitTicks{ 0 };
+    int                                     m_fallbackBatchesLeft{ 0 };
+    std::atomic<int>                        m_numMissedDeadlines{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MatrixRenderWorkerPool)
+};
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,122 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Speaker layouts the matrix has compile time specialized render paths for.
+ * Positions are normalized field coordinates, the listener sits in the middle
+ * and front is at the top. Height speakers are projected into the field plane
+ * at half the radius of the speakers below them.
+ */
+enum class OutputLayout
+{
+    Generic,
+    Surround50,     // L C R RS LS
+    Surround51,     // L C R RS LS LFE
+    Surround71,     // L C R RS LS LFE LSS RSS
+    Surround714,    // L C R RS LS LFE LSS RSS TFL TFR TRL TRR
+};
+
+namespace OutputLayoutPositions
+{
+    // 0.5 * sin(30deg) and 0.5 * sin(60deg) around the field centre
+    constexpr float s_a = 0.25f;
+    constexpr float s_b = 0.4330127f;
+
+    constexpr juce::Point<float> s_positions[] =
+    {
+        { 0.5f - s_a, 0.5f + s_b },                 // L
+        { 0.5f, 1.0f },                             // C
+        { 0.5f + s_a, 0.5f + s_b },                 // R
+        { 0.5f + s_b, 0.5f - s_a },                 // RS
+        { 0.5f - s_b, 0.5f - s_a },                 // LS
+        { 0.5f, 0.5f },                             // LFE
+        { 0.0f, 0.5f },                             // LSS
+        { 1.0f, 0.5f },                             // RSS
+        { 0.5f - 0.5f * s_a, 0.5f + 0.5f * s_b },   // TFL
+        { 0.5f + 0.5f * s_a, 0.5f + 0.5f * s_b },   // TFR
+        { 0.5f - 0.5f * s_b, 0.5f - 0.5f * s_a },   // TRL
+        { 0.5f + 0.5f * s_b, 0.5f - 0.5f * s_a },   // TRR
+    };
+}
+
+//==============================================================================
+// every layout uses the first NumOutputs entries of the common position table
+template <OutputLayout Layout>
+struct OutputLayoutTraits
+{
+    static constexpr int s_numOutputs = 0;
+};
+
+template <>
+struct OutputLayoutTraits<OutputLayout::Surround50>
+{
+    static constexpr int s_numOutputs = 5;
+};
+
+template <>
+struct OutputLayoutTraits<OutputLayout::Surround51>
+{
+    static constexpr int s_numOutputs = 6;
+};
+
+template <>
+struct OutputLayoutTraits<OutputLayout::Surround71>
+{
+    static constexpr int s_numOutputs = 8;
+};
+
+template <>
+struct OutputLayoutTraits<OutputLayout::Surround714>
+{
+    static constexpr int s_numOutputs = 12;
+};
+
+//==============================================================================
+constexpr int getOutputLayoutOutputCount(OutputLayout layout)
+{
+    switch (layout)
+    {
+    case OutputLayout::Surround50:
+        return OutputLayoutTraits<OutputLayout::Surround50>::s_numOutputs;
+    case OutputLayout::Surround51:
+        return OutputLayoutTraits<OutputLayout::Surround51>::s_numOutputs;
+    case OutputLayout::Surround71:
+        return OutputLayoutTraits<OutputLayout::Surround71>::s_numOutputs;
+    case OutputLayout::Surround714:
+        return OutputLayoutTraits<OutputLayout::Surround714>::s_numOutputs;
+    case OutputLayout::Generic:
+    default:
+        return 0;
+    }
+}
+
+constexpr juce::Point<float> getOutputLayoutPosition(OutputLayout layout, int outputIdx)
+{
+    return (outputIdx >= 0 && outputIdx < getOutputLayoutOutputCount(layout)) ? OutputLayoutPositions::s_positions[outputIdx] : juce::Point<float>(0.5f, 0.5f);
+}
+
+} // namespace SurroundFieldMixer
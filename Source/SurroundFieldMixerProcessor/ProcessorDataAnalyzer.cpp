@@ -23,63 +23,165 @@ namespace SurroundFieldMixer
 
 #define USE_LEVEL_PROCESSING
 //#define USE_BUFFER_PROCESSING
-//#define USE_SPECTRUM_PROCESSING
+#define USE_SPECTRUM_PROCESSING
 
-//==============================================================================
-AudioBufferMessage::AudioBufferMessage(AudioBuffer<float>& buffer)
+namespace
 {
-	m_buffer = buffer;
-}
 
-AudioBufferMessage::~AudioBufferMessage()
+//==============================================================================
+/*
+ * Peak and sum of squares of all given channels in a single pass over the samples,
+ * instead of separate getMagnitude and getRMSLevel passes.
+ */
+void accumulatePeakAndSumOfSquares(const float* const* channels, int numChannels, int startSample, int numSamples, float* peaks, float* sumsOfSquares)
 {
+	for (auto ch = 0; ch < numChannels; ch++)
+	{
+		auto samples = channels[ch] + startSample;
+		auto peak = peaks[ch];
+		auto sumOfSquares = sumsOfSquares[ch];
+		auto i = 0;
 
-}
+#if JUCE_USE_SIMD
+		using Register = dsp::SIMDRegister<float>;
 
-const AudioBuffer<float>& AudioBufferMessage::getAudioBuffer() const
-{
-	return m_buffer;
+		for (; i < numSamples && !Register::isSIMDAligned(samples + i); i++)
+		{
+			peak = jmax(peak, std::abs(samples[i]));
+			sumOfSquares += samples[i] * samples[i];
+		}
+
+		auto peakRegister = Register::expand(0.0f);
+		auto sumOfSquaresRegister = Register::expand(0.0f);
+		for (; i + static_cast<int>(Register::SIMDNumElements) <= numSamples; i += static_cast<int>(Register::SIMDNumElements))
+		{
+			auto x = Register::fromRawArray(samples + i);
+			peakRegister = Register::max(peakRegister, Register::abs(x));
+			sumOfSquaresRegister = Register::multiplyAdd(sumOfSquaresRegister, x, x);
+		}
+		for (size_t j = 0; j < Register::SIMDNumElements; j++)
+			peak = jmax(peak, peakRegister.get(j));
+		sumOfSquares += sumOfSquaresRegister.sum();
+#endif
+
+		for (; i < numSamples; i++)
+		{
+			peak = jmax(peak, std::abs(samples[i]));
+			sumOfSquares += samples[i] * samples[i];
+		}
+
+		peaks[ch] = peak;
+		sumsOfSquares[ch] = sumOfSquares;
+	}
 }
 
+} // namespace
+
+
 //==============================================================================
-ProcessorDataAnalyzer::ProcessorDataAnalyzer() :
-	m_fwdFFT(fftOrder),
-	m_windowF(fftSize, dsp::WindowingFunction<float>::hann)
+ProcessorDataAnalyzer::ProcessorDataAnalyzer(bool startWorkerAndTimer) :
+	Thread("ProcessorDataAnalyzer")
 {
-	m_FFTdataPos = 0;
-	zeromem(m_FFTdata, sizeof(m_FFTdata));
-
 	setHoldTime(500);
+
+	if (startWorkerAndTimer)
+	{
+		startThread();
+		startTimer(s_broadcastIntervalMs);
+	}
 }
 
 ProcessorDataAnalyzer::~ProcessorDataAnalyzer()
 {
+	stopTimer();
+	stopThread(1000);
+}
+
+int ProcessorDataAnalyzer::getFifoCapacity(double sampleRate, int bufferSize)
+{
+	// room for at least 100ms of audio, the consumer drains every s_fifoDrainIntervalMs
+	return jmax(4 * bufferSize, static_cast<int>(sampleRate * 0.1));
+}
 
+size_t ProcessorDataAnalyzer::getRequiredMemorySize(double sampleRate, int bufferSize, int numChannels)
+{
+	return AudioBufferFifo::getRequiredMemorySize(jmax(1, numChannels), getFifoCapacity(sampleRate, bufferSize));
 }
 
-void ProcessorDataAnalyzer::initializeParameters(double sampleRate, int bufferSize)
+void ProcessorDataAnalyzer::initializeParameters(double sampleRate, int bufferSize, int numChannels, AudioMemoryArena& memory)
 {
+	const ScopedLock sl(m_readLock);
+
+	// the fifo is written by the audio thread, so its memory comes from the arena the processor prepares
+	auto fifoCapacity = getFifoCapacity(sampleRate, bufferSize);
+	m_channelCount = jmax(1, numChannels);
+	m_fifo.setSize(m_channelCount, fifoCapacity, memory);
+	m_fifoReadBuffer.setSize(m_channelCount, fifoCapacity, false, true, false);
+
 	m_sampleRate = static_cast<unsigned long>(sampleRate);
 	m_samplesPerCentiSecond = static_cast<int>(sampleRate * 0.01f);
 	m_bufferSize = bufferSize;
 	m_missingSamplesForCentiSecond = static_cast<int>(m_samplesPerCentiSecond + 0.5f);
 	m_centiSecondBuffer.setSize(2, m_missingSamplesForCentiSecond, false, true, false);
+
+	// every buffer of the triple buffers takes turns as the one written on the analyzer thread, so all three are reserved here
+	m_level.ReserveChannels(m_channelCount);
+	m_levelSnapshots.forEachBuffer([this](ProcessorLevelData& level) { level.ReserveChannels(m_channelCount); });
+
+	m_peakAccumulators.assign(m_channelCount, 0.0f);
+	m_sumOfSquaresAccumulators.assign(m_channelCount, 0.0f);
+
+	// the spectra are reserved for the maximum band count, so a later band count change never reallocates them
+	m_spectrumEngine.prepare(sampleRate, m_channelCount, m_spectrumBandCount);
+	m_spectrum.SetBandCount(m_spectrumBandCount);
+	m_spectrum.ReserveChannels(m_channelCount, SpectrumAnalyzerEngine::s_maxBandCount);
+	m_spectrumSnapshots.forEachBuffer([this](ProcessorSpectrumData& spectrum) {
+		spectrum.SetBandCount(m_spectrumBandCount);
+		spectrum.ReserveChannels(m_channelCount, SpectrumAnalyzerEngine::s_maxBandCount);
+	});
 }
 
 void ProcessorDataAnalyzer::clearParameters()
 {	
+	const ScopedLock sl(m_readLock);
+
+	m_fifo.reset();
+
 	m_sampleRate = 0;
 	m_samplesPerCentiSecond = 0;
 	m_bufferSize = 0;
 	m_centiSecondBuffer.clear();
 	m_missingSamplesForCentiSecond = 0;
+
+	std::fill(m_peakAccumulators.begin(), m_peakAccumulators.end(), 0.0f);
+	std::fill(m_sumOfSquaresAccumulators.begin(), m_sumOfSquaresAccumulators.end(), 0.0f);
+
+	m_spectrumEngine.reset();
 }
 
 void ProcessorDataAnalyzer::setHoldTime(int holdTimeMs)
 {
 	m_holdTimeMs = holdTimeMs;
+}
+
+void ProcessorDataAnalyzer::setSpectrumBandCount(int bandCount)
+{
+	const ScopedLock sl(m_readLock);
 
-	startTimer(m_holdTimeMs);
+	bandCount = jlimit(1, SpectrumAnalyzerEngine::s_maxBandCount, bandCount);
+	if (m_spectrumBandCount == bandCount)
+		return;
+
+	m_spectrumBandCount = bandCount;
+
+	// reconfigure right away if already running, otherwise this is picked up by initializeParameters.
+	// Only the analyzer side is touched, the snapshots take the new count when the next spectrum is published
+	// into the write buffer. The buffers the message thread reads keep their storage and stay valid.
+	if (m_sampleRate > 0)
+	{
+		m_spectrumEngine.prepare(static_cast<double>(m_sampleRate), m_channelCount, m_spectrumBandCount);
+		m_spectrum.SetBandCount(m_spectrumBandCount);
+	}
 }
 
 void ProcessorDataAnalyzer::addListener(Listener* listener)
@@ -92,6 +194,39 @@ void ProcessorDataAnalyzer::removeListener(Listener* listener)
 	m_callbackListeners.remove(m_callbackListeners.indexOf(listener));
 }
 
+void ProcessorDataAnalyzer::pushAudioBuffer(const AudioBuffer<float>& buffer)
+{
+	// called from the audio thread, never blocks or allocates but drops the block if the fifo is full
+	m_fifo.push(buffer);
+}
+
+void ProcessorDataAnalyzer::pushAudioBuffer(const float* const* channelData, int numChannels, int numSamples)
+{
+	// same as above, for callers that work on raw channel pointers without an AudioBuffer around them
+	m_fifo.push(channelData, numChannels, numSamples);
+}
+
+void ProcessorDataAnalyzer::pushAudioBuffer(const double* const* channelData, int numChannels, int numSamples)
+{
+	// analysis runs in single precision, the fifo converts
+	m_fifo.push(channelData, numChannels, numSamples);
+}
+
+void ProcessorDataAnalyzer::ProcessFifo()
+{
+	const ScopedLock sl(m_readLock);
+
+	if (m_samplesPerCentiSecond <= 0)
+		return;
+
+	auto numReady = m_fifo.getNumReady();
+	if (numReady <= 0)
+		return;
+
+	m_fifo.pull(m_fifoReadBuffer, numReady);
+	analyzeData(m_fifoReadBuffer);
+}
+
 void ProcessorDataAnalyzer::analyzeData(const AudioBuffer<float>& buffer)
 {
 	int numChannels = buffer.getNumChannels();
@@ -103,10 +238,21 @@ void ProcessorDataAnalyzer::analyzeData(const AudioBuffer<float>& buffer)
 
 	int availableSamples = buffer.getNumSamples();
 
+#ifdef USE_SPECTRUM_PROCESSING
+	// generate spectrum data, independent of the centisecond framing
+	m_spectrumEngine.pushSamples(buffer, 0, availableSamples);
+	if (m_spectrumEngine.processPendingFrames(m_spectrum, static_cast<float>(getGlobalMindB()), static_cast<float>(getGlobalMaxdB())))
+		PublishData(&m_spectrum);
+#endif
+
 	int readPos = 0;
 	int writePos = m_samplesPerCentiSecond - m_missingSamplesForCentiSecond;
 	while (availableSamples >= m_missingSamplesForCentiSecond)
 	{
+#ifdef USE_LEVEL_PROCESSING
+		AccumulateLevels(buffer, readPos, m_missingSamplesForCentiSecond);
+#endif
+
 		for (int i = 0; i < numChannels; ++i)
 		{
 #ifdef USE_BUFFER_PROCESSING
@@ -115,86 +261,25 @@ void ProcessorDataAnalyzer::analyzeData(const AudioBuffer<float>& buffer)
 #endif
 
 #ifdef USE_LEVEL_PROCESSING
-			// generate level data
-			auto peak = m_centiSecondBuffer.getMagnitude(i, 0, m_samplesPerCentiSecond);
-			auto rms = m_centiSecondBuffer.getRMSLevel(i, 0, m_samplesPerCentiSecond);
-			auto hold = std::max(peak, m_level.GetLevel(i + 1).hold);
-			m_level.SetLevel(i + 1, ProcessorLevelData::LevelVal(peak, rms, hold, static_cast<float>(getGlobalMindB())));
-#endif
-
-#ifdef USE_SPECTRUM_PROCESSING
-			// generate spectrum data
+			// generate level data from the values accumulated over the last centisecond
+			if (i < static_cast<int>(m_peakAccumulators.size()))
 			{
-				int unprocessedSamples = 0;
-				if (m_FFTdataPos < fftSize)
-				{
-					int missingSamples = fftSize - m_FFTdataPos;
-					if (missingSamples < m_samplesPerCentiSecond)
-					{
-						memcpy(m_FFTdata, m_centiSecondBuffer.getReadPointer(i), missingSamples);
-						m_FFTdataPos += missingSamples;
-						unprocessedSamples = m_samplesPerCentiSecond - missingSamples;
-					}
-					else
-					{
-						memcpy(m_FFTdata, m_centiSecondBuffer.getReadPointer(i), m_samplesPerCentiSecond);
-						m_FFTdataPos += m_samplesPerCentiSecond;
-					}
-				}
-
-				if (m_FFTdataPos >= fftSize)
-				{
-					m_windowF.multiplyWithWindowingTable(m_FFTdata, fftSize);
-					m_fwdFFT.performFrequencyOnlyForwardTransform(m_FFTdata);
-					ProcessorSpectrumData::SpectrumBands spectrumBands = m_spectrum.GetSpectrum(i);
-
-					spectrumBands.mindB = static_cast<float>(getGlobalMindB());
-					spectrumBands.maxdB = static_cast<float>(getGlobalMaxdB());
-
-					spectrumBands.minFreq = static_cast<float>(m_sampleRate / ProcessorSpectrumData::SpectrumBands::count);
-					spectrumBands.maxFreq = static_cast<float>(m_sampleRate / 2);
-					spectrumBands.freqRes = static_cast<float>((spectrumBands.maxFreq - spectrumBands.minFreq) / ProcessorSpectrumData::SpectrumBands::count);
-
-					auto spectrumStepWidth = static_cast<int>(0.5f * (fftSize / ProcessorSpectrumData::SpectrumBands::count));
-					auto spectrumPos = 0;
-					for (int j = 0; j < ProcessorSpectrumData::SpectrumBands::count && spectrumPos < fftSize; ++j)
-					{
-						float spectrumVal = 0;
-
-						for (int k = 0; k < spectrumStepWidth; ++k, ++spectrumPos)
-							spectrumVal += m_FFTdata[spectrumPos];
-						spectrumVal = spectrumVal / spectrumStepWidth;
-
-						auto leveldB = jlimit(spectrumBands.mindB, spectrumBands.maxdB, Decibels::gainToDecibels(spectrumVal));
-						auto level = jmap(leveldB, spectrumBands.mindB, spectrumBands.maxdB, 0.0f, 1.0f);
-
-						spectrumBands.bandsPeak[j] = level;
-						spectrumBands.bandsHold[j] = std::max(level, spectrumBands.bandsHold[j]);
-					}
-
-					m_spectrum.SetSpectrum(i, spectrumBands);
-
-					zeromem(m_FFTdata, sizeof(m_FFTdata));
-					m_FFTdataPos = 0;
-				}
-
-				if (unprocessedSamples != 0)
-				{
-					memcpy(m_FFTdata, m_centiSecondBuffer.getReadPointer(i, m_samplesPerCentiSecond - unprocessedSamples), unprocessedSamples);
-					m_FFTdataPos += unprocessedSamples;
-				}
+				auto peak = m_peakAccumulators[i];
+				auto rms = std::sqrt(m_sumOfSquaresAccumulators[i] / static_cast<float>(m_samplesPerCentiSecond));
+				auto hold = std::max(peak, m_level.GetLevel(i + 1).hold);
+				m_level.SetLevel(i + 1, ProcessorLevelData::LevelVal(peak, rms, hold, static_cast<float>(getGlobalMindB())));
+
+				m_peakAccumulators[i] = 0.0f;
+				m_sumOfSquaresAccumulators[i] = 0.0f;
 			}
 #endif
 		}
 
 #ifdef USE_LEVEL_PROCESSING
-		BroadcastData(&m_level);
+		PublishData(&m_level);
 #endif
 #ifdef USE_BUFFER_PROCESSING
-		BroadcastData(&m_centiSecondBuffer);
-#endif
-#ifdef USE_SPECTRUM_PROCESSING
-		BroadcastData(&m_spectrum);
+		PublishData(&m_centiSecondBuffer);
 #endif
 
 		readPos += m_missingSamplesForCentiSecond;
@@ -210,10 +295,46 @@ void ProcessorDataAnalyzer::analyzeData(const AudioBuffer<float>& buffer)
 
 	if (availableSamples > 0)
 	{
+#ifdef USE_LEVEL_PROCESSING
+		AccumulateLevels(buffer, readPos, availableSamples);
+#endif
+
 		for (int i = 0; i < numChannels; ++i)
 		{
 			m_centiSecondBuffer.copyFrom(i, writePos, buffer.getReadPointer(i) + readPos, availableSamples);
 		}
+
+		// the leftover samples are part of the next centisecond, which then only needs the rest
+		m_missingSamplesForCentiSecond -= availableSamples;
+	}
+}
+
+void ProcessorDataAnalyzer::AccumulateLevels(const AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+	auto numChannels = jmin(buffer.getNumChannels(), static_cast<int>(m_peakAccumulators.size()));
+	accumulatePeakAndSumOfSquares(buffer.getArrayOfReadPointers(), numChannels, startSample, numSamples, m_peakAccumulators.data(), m_sumOfSquaresAccumulators.data());
+}
+
+void ProcessorDataAnalyzer::PublishData(AbstractProcessorData* data)
+{
+	// only the most recent frame is of interest, the message thread picks it up whenever it gets to it
+	switch (data->GetDataType())
+	{
+	case AbstractProcessorData::AudioSignal:
+		m_centiSecondBufferSnapshots.getWriteBuffer() = *static_cast<ProcessorAudioSignalData*>(data);
+		m_centiSecondBufferSnapshots.publish();
+		break;
+	case AbstractProcessorData::Level:
+		m_levelSnapshots.getWriteBuffer() = *static_cast<ProcessorLevelData*>(data);
+		m_levelSnapshots.publish();
+		break;
+	case AbstractProcessorData::Spectrum:
+		m_spectrumSnapshots.getWriteBuffer() = *static_cast<ProcessorSpectrumData*>(data);
+		m_spectrumSnapshots.publish();
+		break;
+	case AbstractProcessorData::Invalid:
+	default:
+		break;
 	}
 }
 
@@ -223,13 +344,40 @@ void ProcessorDataAnalyzer::BroadcastData(AbstractProcessorData* data)
 		l->processingDataChanged(data);
 }
 
+void ProcessorDataAnalyzer::run()
+{
+	// level sums and fft bins of decaying signals must not drop into denormals
+	ScopedNoDenormals noDenormals;
+
+	while (!threadShouldExit())
+	{
+		wait(s_fifoDrainIntervalMs);
+
+		ProcessFifo();
+
+		auto now = Time::getMillisecondCounter();
+		if (now - m_lastHoldFlushMs >= static_cast<juce::uint32>(m_holdTimeMs.load()))
+		{
+			m_lastHoldFlushMs = now;
+			FlushHold();
+		}
+	}
+}
+
 void ProcessorDataAnalyzer::timerCallback()
 {
-	FlushHold();
+	if (m_levelSnapshots.update())
+		BroadcastData(&m_levelSnapshots.getReadBuffer());
+	if (m_centiSecondBufferSnapshots.update())
+		BroadcastData(&m_centiSecondBufferSnapshots.getReadBuffer());
+	if (m_spectrumSnapshots.update())
+		BroadcastData(&m_spectrumSnapshots.getReadBuffer());
 }
 
 void ProcessorDataAnalyzer::FlushHold()
 {
+	const ScopedLock sl(m_readLock);
+
 	// clear level hold values
 	auto channelCount = static_cast<int>(m_level.GetChannelCount());
 	for (auto i = 0; i < channelCount; ++i)
@@ -237,19 +385,68 @@ void ProcessorDataAnalyzer::FlushHold()
 		m_level.SetLevel(i + 1, ProcessorLevelData::LevelVal(0.0f, 0.0f, 0.0f));
 	}
 
-	// clear spectrum hold values	auto channelCount = m_level.GetChannelCount();
-	channelCount = static_cast<int>(m_spectrum.GetChannelCount());
-	for (auto i = 0; i < channelCount; ++i)
+	// clear spectrum hold values
+	m_spectrum.ClearBands();
+}
+
+
+#if JUCE_UNIT_TESTS
+
+//==============================================================================
+/*
+ * Levels have to cover exactly one centisecond, no matter how the device splits
+ * the audio into blocks.
+ */
+class ProcessorDataAnalyzerTests : public UnitTest
+{
+public:
+	ProcessorDataAnalyzerTests() : UnitTest("ProcessorDataAnalyzer", "SurroundFieldMixer") {}
+
+	void runTest() override
 	{
-		ProcessorSpectrumData::SpectrumBands spectrumBands = m_spectrum.GetSpectrum(i);
-		for (auto j = 0; j < ProcessorSpectrumData::SpectrumBands::count; ++j)
+		beginTest("Sine level with odd block sizes");
+
+		constexpr auto sampleRate = 44100.0;
+		constexpr auto amplitude = 0.5f;
+		constexpr auto frequency = 1000.0; // a centisecond holds whole periods, so every window has the same rms
+		const int blockSizes[] = { 441, 7 };
+
+		AudioMemoryArena memory;
+		memory.allocate(ProcessorDataAnalyzer::getRequiredMemorySize(sampleRate, 512, 1), false);
+
+		// the test takes the roles of the worker thread and the timer, so none of them are started
+		ProcessorDataAnalyzer analyzer(false);
+		analyzer.setHoldTime(std::numeric_limits<int>::max());
+		analyzer.initializeParameters(sampleRate, 512, 1, memory);
+
+		AudioBuffer<float> block(1, 512);
+		auto samplePos = 0;
+		for (auto blockIdx = 0; blockIdx < 200; blockIdx++)
 		{
-			spectrumBands.bandsPeak[j] = 0.0f;
-			spectrumBands.bandsHold[j] = 0.0f;
+			auto numSamples = blockSizes[blockIdx % 2];
+			block.setSize(1, numSamples, false, false, true);
+			for (auto i = 0; i < numSamples; i++, samplePos++)
+				block.setSample(0, i, amplitude * static_cast<float>(std::sin(MathConstants<double>::twoPi * frequency * samplePos / sampleRate)));
+
+			// audio thread, worker thread, message thread
+			analyzer.pushAudioBuffer(block);
+			analyzer.ProcessFifo();
+			analyzer.timerCallback();
+
+			auto level = analyzer.GetLevel().GetLevel(1);
+			if (samplePos >= 441)
+			{
+				expectWithinAbsoluteError(level.rms, amplitude * MathConstants<float>::sqrt2 * 0.5f, 0.001f);
+				expectWithinAbsoluteError(level.peak, amplitude, 0.01f);
+			}
 		}
 
-		m_spectrum.SetSpectrum(i, spectrumBands);
+		analyzer.clearParameters();
 	}
-}
+};
+
+static ProcessorDataAnalyzerTests processorDataAnalyzerTests;
+
+#endif
 
 } // namespace SurroundFieldMixer
\ No newline at end of file
@@ -20,9 +20,12 @@
 
 #include <JuceHeader.h>
 
+#include "AudioBufferFifo.h"
 #include "ProcessorAudioSignalData.h"
 #include "ProcessorLevelData.h"
 #include "ProcessorSpectrumData.h"
+#include "SpectrumAnalyzerEngine.h"
+#include "TripleBuffer.h"
 
 
 namespace SurroundFieldMixer
@@ -30,48 +33,13 @@ namespace SurroundFieldMixer
 
 //==============================================================================
 /*
-*/
-class AudioBufferMessage : public Message
-{
-public:
-    enum FlowDirection
-    {
-        Invalid,
-        Input, 
-        Output,
-    };
-
-public:
-    AudioBufferMessage(AudioBuffer<float>& buffer);
-    ~AudioBufferMessage();
-
-    const AudioBuffer<float>& getAudioBuffer() const;
-    const FlowDirection getFlowDirection() const { return m_direction; };
-
-protected:
-    FlowDirection m_direction{ FlowDirection::Invalid };
-
-private:
-    AudioBuffer<float> m_buffer;
-
-};
-
-class AudioInputBufferMessage : public AudioBufferMessage
-{
-public:
-    AudioInputBufferMessage(AudioBuffer<float>& buffer) : AudioBufferMessage(buffer) { m_direction = FlowDirection::Input; }
-};
-
-class AudioOutputBufferMessage : public AudioBufferMessage
-{
-public:
-    AudioOutputBufferMessage(AudioBuffer<float>& buffer) : AudioBufferMessage(buffer) { m_direction = FlowDirection::Output; }
-};
-
-//==============================================================================
-/*
-*/
-class ProcessorDataAnalyzer :    public Timer
+ * Analysis of the audio blocks pushed from the audio thread runs on a worker
+ * thread owned by each analyzer instance. The worker publishes its results
+ * into lock-free latest-value slots, a message thread timer picks up the most
+ * recent ones and forwards them to the listeners.
+ */
+class ProcessorDataAnalyzer :    public Thread,
+                                 public Timer
 {
 public:
     class Listener
@@ -83,18 +51,20 @@ public:
     };
 
 public:
-    ProcessorDataAnalyzer();
+    // without the worker thread and the broadcast timer the fifo is only drained and published when driven by hand, as the tests do
+    explicit ProcessorDataAnalyzer(bool startWorkerAndTimer = true);
     ~ProcessorDataAnalyzer();
 
     //==============================================================================
-    void initializeParameters(double sampleRate, int bufferSize);
+    void initializeParameters(double sampleRate, int bufferSize, int numChannels, AudioMemoryArena& memory);
     void clearParameters();
 
     void setHoldTime(int holdTimeMs);
+    void setSpectrumBandCount(int bandCount);
 
-    ProcessorAudioSignalData& GetCentiSecondBuffer() { return m_centiSecondBuffer; };
-    ProcessorLevelData& GetLevel() { return m_level; };
-    ProcessorSpectrumData& GetSpectrum() { return m_spectrum; };
+    ProcessorAudioSignalData& GetCentiSecondBuffer() { return m_centiSecondBufferSnapshots.getReadBuffer(); };
+    ProcessorLevelData& GetLevel() { return m_levelSnapshots.getReadBuffer(); };
+    ProcessorSpectrumData& GetSpectrum() { return m_spectrumSnapshots.getReadBuffer(); };
     String& GetName() { return m_Name; };
 
     //==============================================================================
@@ -102,8 +72,14 @@ public:
     void removeListener(Listener* listener);
 
     //==============================================================================
+    void pushAudioBuffer(const AudioBuffer<float>& buffer);
+    void pushAudioBuffer(const float* const* channelData, int numChannels, int numSamples);
+    void pushAudioBuffer(const double* const* channelData, int numChannels, int numSamples);
     void analyzeData(const AudioBuffer<float>& buffer);
 
+    //==============================================================================
+    void run() override;
+
     //==============================================================================
     void timerCallback() override;
 
@@ -124,42 +100,56 @@ public:
         return dBRange::max;
     }
 
-    static constexpr int s_maxChannelCount = 64;
-    static constexpr int s_maxNumSamples = 1024;
+    static size_t getRequiredMemorySize(double sampleRate, int bufferSize, int numChannels);
+
+    static constexpr int s_fifoDrainIntervalMs = 10;
+    static constexpr int s_broadcastIntervalMs = 10;
 
 private:
+    friend class ProcessorDataAnalyzerTests;
+
+    static int getFifoCapacity(double sampleRate, int bufferSize);
+
+    void ProcessFifo();
+    void AccumulateLevels(const AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void PublishData(AbstractProcessorData* data);
     void BroadcastData(AbstractProcessorData* data);
     void FlushHold();
 
+    // owned by the worker thread
     ProcessorAudioSignalData    m_centiSecondBuffer;
     ProcessorLevelData          m_level;
     ProcessorSpectrumData       m_spectrum;
 
+    // written by the worker thread, read on the message thread
+    TripleBuffer<ProcessorAudioSignalData>  m_centiSecondBufferSnapshots;
+    TripleBuffer<ProcessorLevelData>        m_levelSnapshots;
+    TripleBuffer<ProcessorSpectrumData>     m_spectrumSnapshots;
+
     String                      m_Name;
     Array<Listener*>            m_callbackListeners;
 
     //==============================================================================
     CriticalSection     m_readLock;
 
-    float**             m_processorChannels;
+    AudioBufferFifo     m_fifo;
+    AudioBuffer<float>  m_fifoReadBuffer;
 
     unsigned long       m_sampleRate = 0;
     int                 m_samplesPerCentiSecond = 0;
     int                 m_bufferSize = 0;
+    int                 m_channelCount = 0;
     int                 m_missingSamplesForCentiSecond;
 
+    std::vector<float>  m_peakAccumulators;
+    std::vector<float>  m_sumOfSquaresAccumulators;
+
     //==============================================================================
-    enum
-    {
-        fftOrder = 12,
-        fftSize = 1 << fftOrder
-    };
-    dsp::FFT                                    m_fwdFFT;
-    dsp::WindowingFunction<float>               m_windowF;
-    float                                       m_FFTdata[2 * fftSize];
-    int                                         m_FFTdataPos;
+    SpectrumAnalyzerEngine                      m_spectrumEngine;
+    int                                         m_spectrumBandCount{ SpectrumAnalyzerEngine::s_defaultBandCount };
 
-    int                                         m_holdTimeMs;
+    std::atomic<int>                            m_holdTimeMs{ 0 };
+    juce::uint32                                m_lastHoldFlushMs{ 0 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorDataAnalyzer)
 };
@@ -33,13 +33,26 @@ ProcessorLevelData::~ProcessorLevelData()
 
 void ProcessorLevelData::SetLevel(unsigned long channel, ProcessorLevelData::LevelVal level)
 {
-    m_levelMap[channel] = level;
+    if (channel < 1)
+        return;
+
+    if (channel > GetChannelCount())
+        SetChannelCount(channel);
+
+    auto idx = channel - 1;
+    m_peaks[idx] = level.peak;
+    m_rms[idx] = level.rms;
+    m_holds[idx] = level.hold;
+    m_minusInfdb = level.minusInfdb;
 }
 
 ProcessorLevelData::LevelVal ProcessorLevelData::GetLevel(unsigned long channel)
 {
-    if(m_levelMap.count(channel))
-        return m_levelMap.at(channel);
+    if (channel >= 1 && channel <= GetChannelCount())
+    {
+        auto idx = channel - 1;
+        return ProcessorLevelData::LevelVal(m_peaks[idx], m_rms[idx], m_holds[idx], m_minusInfdb);
+    }
     else
         return ProcessorLevelData::LevelVal(0,0,0);
 }
@@ -49,16 +62,25 @@ void ProcessorLevelData::SetChannelCount(unsigned long count)
     if(GetChannelCount()==count)
         return;
     
-    for(unsigned long i=1; i<=count; i++)
-    {
-        if (!m_levelMap.count(i))
-            m_levelMap[i] = LevelVal(0, 0, 0);
-    }
+    // channels that were reported once are kept, the count only grows
+    if (count < GetChannelCount())
+        return;
+
+    m_peaks.resize(count, 0.0f);
+    m_rms.resize(count, 0.0f);
+    m_holds.resize(count, 0.0f);
 }
 
 unsigned long ProcessorLevelData::GetChannelCount()
 {
-    return static_cast<unsigned long>(m_levelMap.size());
+    return static_cast<unsigned long>(m_peaks.size());
+}
+
+void ProcessorLevelData::ReserveChannels(unsigned long capacity)
+{
+    m_peaks.reserve(capacity);
+    m_rms.reserve(capacity);
+    m_holds.reserve(capacity);
 }
 
 }
\ No newline at end of file
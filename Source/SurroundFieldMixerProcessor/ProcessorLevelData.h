@@ -33,9 +33,6 @@ public:
             peak = 0.0f;
             rms = 0.0f;
             hold = 0.0f;
-            peakdB = 0.0f;
-            rmsdB = 0.0f;
-            holddB = 0.0f;
             minusInfdb = -10000.0f;
         }
         LevelVal(float p, float r, float h, float infdb = -100.0f)
@@ -43,31 +40,39 @@ public:
             peak = p;
             rms = r;
             hold = h;
-            peakdB = Decibels::gainToDecibels(peak, infdb);
-            rmsdB = Decibels::gainToDecibels(rms, infdb);
-            holddB = Decibels::gainToDecibels(hold, infdb);
             minusInfdb = infdb;
         }
 
-        float GetFactorRMSdB()
+        // dB values are only calculated when actually requested by a consumer
+        float GetPeakdB() const
         {
-            return (-1 * minusInfdb + rmsdB) / (-1 * minusInfdb);
+            return Decibels::gainToDecibels(peak, minusInfdb);
         }
-        float GetFactorPEAKdB()
+        float GetRMSdB() const
         {
-            return (-1 * minusInfdb + peakdB) / (-1 * minusInfdb);
+            return Decibels::gainToDecibels(rms, minusInfdb);
         }
-        float GetFactorHOLDdB()
+        float GetHolddB() const
         {
-            return (-1 * minusInfdb + holddB) / (-1 * minusInfdb);
+            return Decibels::gainToDecibels(hold, minusInfdb);
+        }
+
+        float GetFactorRMSdB() const
+        {
+            return (-1 * minusInfdb + GetRMSdB()) / (-1 * minusInfdb);
+        }
+        float GetFactorPEAKdB() const
+        {
+            return (-1 * minusInfdb + GetPeakdB()) / (-1 * minusInfdb);
+        }
+        float GetFactorHOLDdB() const
+        {
+            return (-1 * minusInfdb + GetHolddB()) / (-1 * minusInfdb);
         }
         
         float   peak;
         float   rms;
         float   hold;
-        float   peakdB;
-        float   rmsdB;
-        float   holddB;
         float   minusInfdb;
     };
     
@@ -80,9 +85,16 @@ public:
     
     void SetChannelCount(unsigned long count) override;
     unsigned long GetChannelCount() override;
+
+    void ReserveChannels(unsigned long capacity);
     
 private:
-    std::map<unsigned long, LevelVal>    m_levelMap;
+    // flat per channel value arrays, index is channel - 1. Storage is reserved upfront,
+    // so neither setting values nor copying the whole object to a listener allocates.
+    std::vector<float>  m_peaks;
+    std::vector<float>  m_rms;
+    std::vector<float>  m_holds;
+    float               m_minusInfdb{ -100.0f };
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ProcessorParameterSnapshot.h"
+
+namespace SurroundFieldMixer
+{
+
+ProcessorParameterSnapshot::ProcessorParameterSnapshot()
+{
+}
+
+void ProcessorParameterSnapshot::setInputCount(int count)
+{
+	auto channelCount = static_cast<size_t>(count);
+
+	inputMutes.resize(channelCount, false);
+	inputGains.resize(channelCount, 0.0f);
+	inputReverbs.resize(channelCount, 0.0f);
+	inputSpreads.resize(channelCount, 0.0f);
+	inputPositions.resize(channelCount, juce::Point<float>());
+
+	inputToOutputGains.resize(channelCount * static_cast<size_t>(matrixOutputCount), 0.0f);
+	inputToOutputDelays.resize(channelCount * static_cast<size_t>(matrixOutputCount), 0.0f);
+	inputToOutputDecorrelatedGains.resize(channelCount * static_cast<size_t>(matrixOutputCount), 0.0f);
+	matrixRowVersions.resize(channelCount, 0);
+}
+
+void ProcessorParameterSnapshot::setOutputCount(int count)
+{
+	auto channelCount = static_cast<size_t>(count);
+
+	outputMutes.resize(channelCount, false);
+	outputGains.resize(channelCount, 0.0f);
+}
+
+void ProcessorParameterSnapshot::setMatrixOutputCount(int count)
+{
+	// changing the row length invalidates all existing rows, they need to be recalculated by the owner
+	matrixOutputCount = count;
+	inputToOutputGains.assign(inputGains.size() * static_cast<size_t>(matrixOutputCount), 0.0f);
+	inputToOutputDelays.assign(inputGains.size() * static_cast<size_t>(matrixOutputCount), 0.0f);
+	inputToOutputDecorrelatedGains.assign(inputGains.size() * static_cast<size_t>(matrixOutputCount), 0.0f);
+	reverbOutputGains.assign(static_cast<size_t>(matrixOutputCount), 0.0f);
+	for (auto& rowVersion : matrixRowVersions)
+		rowVersion = ++lastMatrixRowVersion;
+}
+
+void ProcessorParameterSnapshot::markMatrixRowChanged(int inputIdx)
+{
+	matrixRowVersions[static_cast<size_t>(inputIdx)] = ++lastMatrixRowVersion;
+}
+
+void ProcessorParameterSnapshot::updateFrom(const ProcessorParameterSnapshot& source)
+{
+	// the per channel values are small and simply copied, the vectors keep their memory once they have grown
+	inputMutes = source.inputMutes;
+	inputGains = source.inputGains;
+	inputReverbs = source.inputReverbs;
+	inputSpreads = source.inputSpreads;
+	inputPositions = source.inputPositions;
+	outputMutes = source.outputMutes;
+	outputGains = source.outputGains;
+	outputLayout = source.outputLayout;
+	delayEnabled = source.delayEnabled;
+	spreadDecorrelationEnabled = source.spreadDecorrelationEnabled;
+	reverbOutputGains = source.reverbOutputGains;
+	reverbEnabled = source.reverbEnabled;
+
+	// a different table shape takes a full copy, otherwise only the rows stamped since the last update are copied
+	if (matrixOutputCount != source.matrixOutputCount || matrixRowVersions.size() != source.matrixRowVersions.size())
+	{
+		matrixOutputCount = source.matrixOutputCount;
+		inputToOutputGains = source.inputToOutputGains;
+		inputToOutputDelays = source.inputToOutputDelays;
+		inputToOutputDecorrelatedGains = source.inputToOutputDecorrelatedGains;
+		matrixRowVersions = source.matrixRowVersions;
+	}
+	else
+	{
+		auto rowLength = static_cast<size_t>(matrixOutputCount);
+		for (auto inputIdx = 0; inputIdx < source.getInputCount(); inputIdx++)
+		{
+			if (matrixRowVersions[static_cast<size_t>(inputIdx)] == source.matrixRowVersions[static_cast<size_t>(inputIdx)])
+				continue;
+
+			std::copy_n(source.getInputToOutputGains(inputIdx), rowLength, getInputToOutputGains(inputIdx));
+			std::copy_n(source.getInputToOutputDelays(inputIdx), rowLength, getInputToOutputDelays(inputIdx));
+			std::copy_n(source.getInputToOutputDecorrelatedGains(inputIdx), rowLength, getInputToOutputDecorrelatedGains(inputIdx));
+			matrixRowVersions[static_cast<size_t>(inputIdx)] = source.matrixRowVersions[static_cast<size_t>(inputIdx)];
+		}
+	}
+	lastMatrixRowVersion = source.lastMatrixRowVersion;
+}
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,88 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "OutputLayouts.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Plain copy of all control values the audio processing depends on.
+ * Instances are filled on the control side and handed over to the audio
+ * thread as a whole, so the audio thread never has to look into the
+ * lock protected control value maps. Channel indices are zero based.
+ */
+struct ProcessorParameterSnapshot
+{
+    ProcessorParameterSnapshot();
+
+    void setInputCount(int count);
+    void setOutputCount(int count);
+    void setMatrixOutputCount(int count);
+
+    // the matrix rows of an input are stamped whenever they are recalculated, so updateFrom() only has to copy
+    // rows that changed since this snapshot was last updated instead of the whole inputs x outputs tables
+    void markMatrixRowChanged(int inputIdx);
+    void updateFrom(const ProcessorParameterSnapshot& source);
+
+    int getInputCount() const { return static_cast<int>(inputGains.size()); };
+    int getOutputCount() const { return static_cast<int>(outputGains.size()); };
+    int getMatrixOutputCount() const { return matrixOutputCount; };
+
+    float* getInputToOutputGains(int inputIdx) { return inputToOutputGains.data() + inputIdx * matrixOutputCount; };
+    const float* getInputToOutputGains(int inputIdx) const { return inputToOutputGains.data() + inputIdx * matrixOutputCount; };
+    float* getInputToOutputDelays(int inputIdx) { return inputToOutputDelays.data() + inputIdx * matrixOutputCount; };
+    const float* getInputToOutputDelays(int inputIdx) const { return inputToOutputDelays.data() + inputIdx * matrixOutputCount; };
+    float* getInputToOutputDecorrelatedGains(int inputIdx) { return inputToOutputDecorrelatedGains.data() + inputIdx * matrixOutputCount; };
+    const float* getInputToOutputDecorrelatedGains(int inputIdx) const { return inputToOutputDecorrelatedGains.data() + inputIdx * matrixOutputCount; };
+
+    std::vector<bool>               inputMutes;
+    std::vector<float>              inputGains;
+    std::vector<float>              inputReverbs;
+    std::vector<float>              inputSpreads;
+    std::vector<juce::Point<float>> inputPositions;
+
+    std::vector<bool>               outputMutes;
+    std::vector<float>              outputGains;
+
+    // dense inputs x matrix outputs gain and delay (seconds) tables, one contiguous row per input
+    int                             matrixOutputCount{ 0 };
+    // the fixed layout the matrix outputs were created from, Generic for any other speaker layout
+    OutputLayout                    outputLayout{ OutputLayout::Generic };
+    std::vector<float>              inputToOutputGains;
+    std::vector<float>              inputToOutputDelays;
+    bool                            delayEnabled{ false };
+    // gains of the decorrelated copy of spread inputs, same layout as the tables above
+    std::vector<float>              inputToOutputDecorrelatedGains;
+    bool                            spreadDecorrelationEnabled{ false };
+    // per input the stamp of the last change to its rows in the tables above
+    std::vector<uint64>             matrixRowVersions;
+    uint64                          lastMatrixRowVersion{ 0 };
+
+    // per matrix output the level of the shared reverb return, zero for lfe speakers
+    std::vector<float>              reverbOutputGains;
+    bool                            reverbEnabled{ false };
+};
+
+} // namespace SurroundFieldMixer
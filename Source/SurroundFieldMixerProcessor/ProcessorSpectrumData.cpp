@@ -31,17 +31,77 @@ ProcessorSpectrumData::~ProcessorSpectrumData()
 
 }
 
-void ProcessorSpectrumData::SetSpectrum(unsigned long channel, ProcessorSpectrumData::SpectrumBands spectrum)
+ProcessorSpectrumData::SpectrumBands ProcessorSpectrumData::GetSpectrum(unsigned long channel) const
 {
-    m_spectrumsMap[channel] = spectrum;
+    SpectrumBands spectrum;
+    spectrum.mindB = m_mindB;
+    spectrum.maxdB = m_maxdB;
+    spectrum.minFreq = m_minFreq;
+    spectrum.maxFreq = m_maxFreq;
+    spectrum.freqRes = m_freqRes;
+
+    if (channel >= 1 && channel <= m_channelCount)
+    {
+        auto offset = (channel - 1) * static_cast<size_t>(m_bandCount);
+        spectrum.bandsPeak = m_bandsPeak.data() + offset;
+        spectrum.bandsHold = m_bandsHold.data() + offset;
+        spectrum.count = m_bandCount;
+    }
+
+    return spectrum;
+}
+
+float* ProcessorSpectrumData::GetBandsPeak(unsigned long channel)
+{
+    if (channel < 1)
+        return nullptr;
+
+    if (channel > m_channelCount)
+        SetChannelCount(channel);
+
+    return m_bandsPeak.data() + (channel - 1) * static_cast<size_t>(m_bandCount);
 }
 
-const ProcessorSpectrumData::SpectrumBands& ProcessorSpectrumData::GetSpectrum(unsigned long channel)
+float* ProcessorSpectrumData::GetBandsHold(unsigned long channel)
 {
-    if(m_spectrumsMap.count(channel) == 0)
-        m_spectrumsMap.insert(std::pair<unsigned long, SpectrumBands>(channel, ProcessorSpectrumData::SpectrumBands{}));
+    if (channel < 1)
+        return nullptr;
+
+    if (channel > m_channelCount)
+        SetChannelCount(channel);
+
+    return m_bandsHold.data() + (channel - 1) * static_cast<size_t>(m_bandCount);
+}
 
-    return m_spectrumsMap.at(channel);
+void ProcessorSpectrumData::ClearBands()
+{
+    std::fill(m_bandsPeak.begin(), m_bandsPeak.end(), 0.0f);
+    std::fill(m_bandsHold.begin(), m_bandsHold.end(), 0.0f);
+}
+
+void ProcessorSpectrumData::SetBandCount(int count)
+{
+    if (m_bandCount == count)
+        return;
+
+    // changing the band count changes the layout of the whole storage, existing values are dropped
+    m_bandCount = count;
+    m_bandsPeak.assign(m_channelCount * static_cast<size_t>(m_bandCount), 0.0f);
+    m_bandsHold.assign(m_channelCount * static_cast<size_t>(m_bandCount), 0.0f);
+}
+
+int ProcessorSpectrumData::GetBandCount() const
+{
+    return m_bandCount;
+}
+
+void ProcessorSpectrumData::SetRange(float mindB, float maxdB, float minFreq, float maxFreq, float freqRes)
+{
+    m_mindB = mindB;
+    m_maxdB = maxdB;
+    m_minFreq = minFreq;
+    m_maxFreq = maxFreq;
+    m_freqRes = freqRes;
 }
 
 void ProcessorSpectrumData::SetChannelCount(unsigned long count)
@@ -49,16 +109,25 @@ void ProcessorSpectrumData::SetChannelCount(unsigned long count)
     if(GetChannelCount()==count)
         return;
     
-    for(unsigned long i=1; i<=count; i++)
-    {
-        if(!m_spectrumsMap.count(i))
-            m_spectrumsMap[i] = SpectrumBands();
-    }
+    // channels that were reported once are kept, the count only grows
+    if (count < GetChannelCount())
+        return;
+
+    m_channelCount = count;
+    m_bandsPeak.resize(m_channelCount * static_cast<size_t>(m_bandCount), 0.0f);
+    m_bandsHold.resize(m_channelCount * static_cast<size_t>(m_bandCount), 0.0f);
 }
 
 unsigned long ProcessorSpectrumData::GetChannelCount()
 {
-    return static_cast<unsigned long>(m_spectrumsMap.size());
+    return m_channelCount;
+}
+
+void ProcessorSpectrumData::ReserveChannels(unsigned long capacity, int bandCapacity)
+{
+    // band counts up to bandCapacity then fit into the reserved storage as well
+    m_bandsPeak.reserve(capacity * static_cast<size_t>(jmax(m_bandCount, bandCapacity)));
+    m_bandsHold.reserve(capacity * static_cast<size_t>(jmax(m_bandCount, bandCapacity)));
 }
 
 }
\ No newline at end of file
@@ -25,47 +25,53 @@ namespace SurroundFieldMixer
 class ProcessorSpectrumData : public AbstractProcessorData
 {
 public:
+    /*
+     * Read-only view of the bands of one channel. The band values are not
+     * copied but point into the contiguous storage of the owning object.
+     */
     struct SpectrumBands
     {
-        enum {
-            count = 1024
-        };
-
-        SpectrumBands()
-        {
-            for (int i = 0; i < count; ++i)
-            {
-                bandsPeak[i] = 0.0f;
-                bandsHold[i] = 0.0f;
-            }
-            mindB = 0.0f;
-            maxdB = 0.0f;
-            minFreq = 0.0f;
-            maxFreq = 0.0f;
-            freqRes = 0.0f;
-        };
-        
-        float   bandsPeak[count];
-        float   bandsHold[count];
-        float   mindB;
-        float   maxdB;
-        float   minFreq;
-        float   maxFreq;
-        float   freqRes;
+        const float*    bandsPeak{ nullptr };
+        const float*    bandsHold{ nullptr };
+        int             count{ 0 };
+        float           mindB{ 0.0f };
+        float           maxdB{ 0.0f };
+        float           minFreq{ 0.0f };
+        float           maxFreq{ 0.0f };
+        float           freqRes{ 0.0f };
     };
     
 public:
     ProcessorSpectrumData();
     ~ProcessorSpectrumData();
     
-    void SetSpectrum(unsigned long channel, SpectrumBands spectrum);
-    const SpectrumBands& GetSpectrum(unsigned long channel);
+    SpectrumBands GetSpectrum(unsigned long channel) const;
+
+    float* GetBandsPeak(unsigned long channel);
+    float* GetBandsHold(unsigned long channel);
+    void ClearBands();
+
+    void SetBandCount(int count);
+    int GetBandCount() const;
+    void SetRange(float mindB, float maxdB, float minFreq, float maxFreq, float freqRes);
     
     void SetChannelCount(unsigned long count) override;
     unsigned long GetChannelCount() override;
+
+    void ReserveChannels(unsigned long capacity, int bandCapacity);
     
 private:
-    std::map<unsigned long, SpectrumBands>    m_spectrumsMap;
+    // channel bands are stored back to back, m_bandCount values per channel, index is channel - 1
+    std::vector<float>  m_bandsPeak;
+    std::vector<float>  m_bandsHold;
+    unsigned long       m_channelCount{ 0 };
+    int                 m_bandCount{ 0 };
+
+    float               m_mindB{ 0.0f };
+    float               m_maxdB{ 0.0f };
+    float               m_minFreq{ 0.0f };
+    float               m_maxFreq{ 0.0f };
+    float               m_freqRes{ 0.0f };
 
 };
 
@@ -0,0 +1,302 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SpeakerLayout.h"
+
+namespace SurroundFieldMixer
+{
+
+namespace
+{
+
+const Identifier s_layoutTag("SpeakerLayout");
+const Identifier s_speakerTag("Speaker");
+const Identifier s_nameAttribute("name");
+const Identifier s_ringAttribute("ring");
+const Identifier s_azimuthOffsetAttribute("azimuthOffset");
+const Identifier s_xAttribute("x");
+const Identifier s_yAttribute("y");
+const Identifier s_azimuthAttribute("azimuth");
+const Identifier s_distanceAttribute("distance");
+const Identifier s_lfeAttribute("lfe");
+
+} // namespace
+
+//==============================================================================
+SpeakerLayout::SpeakerLayout()
+{
+}
+
+SpeakerLayout::~SpeakerLayout()
+{
+}
+
+SpeakerLayout SpeakerLayout::createFromOutputLayout(OutputLayout layout, int numGenericOutputs)
+{
+	static const StringArray speakerNames{ "L", "C", "R", "RS", "LS", "LFE", "LSS", "RSS", "TFL", "TFR", "TRL", "TRR" };
+	static constexpr int lfeIdx = 5;
+
+	SpeakerLayout speakerLayout;
+	switch (layout)
+	{
+	case OutputLayout::Surround50:
+		speakerLayout.setName("5.0");
+		break;
+	case OutputLayout::Surround51:
+		speakerLayout.setName("5.1");
+		break;
+	case OutputLayout::Surround71:
+		speakerLayout.setName("7.1");
+		break;
+	case OutputLayout::Surround714:
+		speakerLayout.setName("7.1.4");
+		break;
+	case OutputLayout::Generic:
+	default:
+		speakerLayout.setName("Generic");
+		break;
+	}
+
+	// the generic layout places the first outputs like 5.1 and everything beyond in the field centre
+	auto numOutputs = layout == OutputLayout::Generic ? numGenericOutputs : getOutputLayoutOutputCount(layout);
+	for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+	{
+		if (layout != OutputLayout::Generic || outputIdx <= lfeIdx)
+			speakerLayout.addSpeaker(speakerNames[outputIdx], OutputLayoutPositions::s_positions[outputIdx], outputIdx == lfeIdx);
+		else
+			speakerLayout.addSpeaker(String(outputIdx + 1), s_centrePos());
+	}
+
+	return speakerLayout;
+}
+
+SpeakerLayout SpeakerLayout::createFromChannelSet(const AudioChannelSet& channelSet)
+{
+	SpeakerLayout speakerLayout;
+	speakerLayout.setName(channelSet.getDescription());
+	for (auto const& channelType : channelSet.getChannelTypes())
+	{
+		auto isLFE = channelType == AudioChannelSet::ChannelType::LFE || channelType == AudioChannelSet::ChannelType::LFE2;
+		speakerLayout.addSpeaker(AudioChannelSet::getAbbreviatedChannelTypeName(channelType), getDefaultPosition(channelType), isLFE);
+	}
+
+	return speakerLayout;
+}
+
+SpeakerLayout SpeakerLayout::createRing(int numSpeakers, float azimuthOffsetDegrees)
+{
+	// evenly spaced on the field edge, the first speaker sits at the offset, counting clockwise
+	SpeakerLayout speakerLayout;
+	speakerLayout.setName("Ring " + String(numSpeakers));
+	for (auto speakerIdx = 0; speakerIdx < numSpeakers; speakerIdx++)
+		speakerLayout.addSpeaker(String(speakerIdx + 1), getPositionFromAzimuth(azimuthOffsetDegrees + 360.0f * static_cast<float>(speakerIdx) / static_cast<float>(numSpeakers), 1.0f));
+
+	return speakerLayout;
+}
+
+bool SpeakerLayout::loadFromFile(const File& file)
+{
+	auto stateXml = XmlDocument::parse(file);
+	if (!stateXml)
+		return false;
+
+	return setStateXml(stateXml.get());
+}
+
+bool SpeakerLayout::saveToFile(const File& file) const
+{
+	auto stateXml = createStateXml();
+	if (!stateXml)
+		return false;
+
+	return stateXml->writeTo(file);
+}
+
+std::unique_ptr<XmlElement> SpeakerLayout::createStateXml() const
+{
+	auto stateXml = std::make_unique<XmlElement>(s_layoutTag);
+	stateXml->setAttribute(s_nameAttribute, m_name);
+	for (auto const& speaker : m_speakers)
+	{
+		auto speakerXml = stateXml->createNewChildElement(s_speakerTag);
+		speakerXml->setAttribute(s_nameAttribute, speaker.name);
+		speakerXml->setAttribute(s_xAttribute, speaker.position.getX());
+		speakerXml->setAttribute(s_yAttribute, speaker.position.getY());
+		if (speaker.isLFE)
+			speakerXml->setAttribute(s_lfeAttribute, true);
+	}
+
+	return stateXml;
+}
+
+bool SpeakerLayout::setStateXml(const XmlElement* stateXml)
+{
+	// speakers are either given as a ring count or one by one, in output order.
+	// A speaker is placed by normalized x/y or by azimuth and distance (1 is the field edge), without both it sits in the centre.
+	if (!stateXml || !stateXml->hasTagName(s_layoutTag))
+		return false;
+
+	SpeakerLayout speakerLayout;
+	if (stateXml->hasAttribute(s_ringAttribute))
+	{
+		auto numSpeakers = stateXml->getIntAttribute(s_ringAttribute);
+		if (numSpeakers <= 0)
+			return false;
+
+		speakerLayout = createRing(numSpeakers, static_cast<float>(stateXml->getDoubleAttribute(s_azimuthOffsetAttribute)));
+	}
+	else
+	{
+		for (auto speakerXml : stateXml->getChildWithTagNameIterator(s_speakerTag))
+		{
+			auto position = s_centrePos();
+			if (speakerXml->hasAttribute(s_xAttribute) || speakerXml->hasAttribute(s_yAttribute))
+				position = juce::Point<float>(static_cast<float>(speakerXml->getDoubleAttribute(s_xAttribute, 0.5)), static_cast<float>(speakerXml->getDoubleAttribute(s_yAttribute, 0.5)));
+			else if (speakerXml->hasAttribute(s_azimuthAttribute))
+				position = getPositionFromAzimuth(static_cast<float>(speakerXml->getDoubleAttribute(s_azimuthAttribute)), static_cast<float>(speakerXml->getDoubleAttribute(s_distanceAttribute, 1.0)));
+
+			auto speakerName = speakerXml->getStringAttribute(s_nameAttribute, String(speakerLayout.getNumSpeakers() + 1));
+			speakerLayout.addSpeaker(speakerName, position, speakerXml->getBoolAttribute(s_lfeAttribute));
+		}
+
+		if (speakerLayout.getNumSpeakers() == 0)
+			return false;
+	}
+
+	speakerLayout.setName(stateXml->getStringAttribute(s_nameAttribute, speakerLayout.getName()));
+	*this = std::move(speakerLayout);
+
+	return true;
+}
+
+void SpeakerLayout::setName(const String& name)
+{
+	m_name = name;
+}
+
+const SpeakerLayout::Speaker& SpeakerLayout::getSpeaker(int speakerIdx) const
+{
+	jassert(speakerIdx >= 0 && speakerIdx < getNumSpeakers());
+	return m_speakers[speakerIdx];
+}
+
+juce::Point<float> SpeakerLayout::getSpeakerPosition(int speakerIdx) const
+{
+	if (speakerIdx < 0 || speakerIdx >= getNumSpeakers())
+		return s_centrePos();
+
+	return m_speakers[speakerIdx].position;
+}
+
+void SpeakerLayout::addSpeaker(const String& name, const juce::Point<float>& position, bool isLFE)
+{
+	m_speakers.push_back({ name, position, isLFE });
+	m_speakerX.push_back(position.getX());
+	m_speakerY.push_back(position.getY());
+}
+
+void SpeakerLayout::clear()
+{
+	m_speakers.clear();
+	m_speakerX.clear();
+	m_speakerY.clear();
+}
+
+void SpeakerLayout::computeDistances(const juce::Point<float>& sourcePosition, float* distances, int numDistances) const
+{
+	auto numSpeakers = jmin(numDistances, getNumSpeakers());
+	auto sourceX = sourcePosition.getX();
+	auto sourceY = sourcePosition.getY();
+	for (auto speakerIdx = 0; speakerIdx < numSpeakers; speakerIdx++)
+	{
+		auto dx = m_speakerX[speakerIdx] - sourceX;
+		auto dy = m_speakerY[speakerIdx] - sourceY;
+		distances[speakerIdx] = std::sqrt(dx * dx + dy * dy);
+	}
+
+	auto centreDistance = sourcePosition.getDistanceFrom(s_centrePos());
+	for (auto speakerIdx = numSpeakers; speakerIdx < numDistances; speakerIdx++)
+		distances[speakerIdx] = centreDistance;
+}
+
+juce::Point<float> SpeakerLayout::getPositionFromAzimuth(float azimuthDegrees, float distance)
+{
+	// distance 1 is the field edge, i.e. half the normalized field size away from the centre
+	auto azimuth = degreesToRadians(azimuthDegrees);
+	return s_centrePos() + juce::Point<float>(std::sin(azimuth), std::cos(azimuth)) * (0.5f * distance);
+}
+
+juce::Point<float> SpeakerLayout::getDefaultPosition(AudioChannelSet::ChannelType channelType)
+{
+	// ITU-R BS.775 style angles, surrounds at +-120 like the fixed layouts. Height speakers are projected at half the radius.
+	switch (channelType)
+	{
+	case AudioChannelSet::ChannelType::left:
+		return getPositionFromAzimuth(-30.0f, 1.0f);
+	case AudioChannelSet::ChannelType::right:
+		return getPositionFromAzimuth(30.0f, 1.0f);
+	case AudioChannelSet::ChannelType::centre:
+		return getPositionFromAzimuth(0.0f, 1.0f);
+	case AudioChannelSet::ChannelType::leftSurround:
+		return getPositionFromAzimuth(-120.0f, 1.0f);
+	case AudioChannelSet::ChannelType::rightSurround:
+		return getPositionFromAzimuth(120.0f, 1.0f);
+	case AudioChannelSet::ChannelType::leftCentre:
+		return getPositionFromAzimuth(-15.0f, 1.0f);
+	case AudioChannelSet::ChannelType::rightCentre:
+		return getPositionFromAzimuth(15.0f, 1.0f);
+	case AudioChannelSet::ChannelType::centreSurround:
+		return getPositionFromAzimuth(180.0f, 1.0f);
+	case AudioChannelSet::ChannelType::leftSurroundSide:
+		return getPositionFromAzimuth(-90.0f, 1.0f);
+	case AudioChannelSet::ChannelType::rightSurroundSide:
+		return getPositionFromAzimuth(90.0f, 1.0f);
+	case AudioChannelSet::ChannelType::leftSurroundRear:
+		return getPositionFromAzimuth(-150.0f, 1.0f);
+	case AudioChannelSet::ChannelType::rightSurroundRear:
+		return getPositionFromAzimuth(150.0f, 1.0f);
+	case AudioChannelSet::ChannelType::wideLeft:
+		return getPositionFromAzimuth(-60.0f, 1.0f);
+	case AudioChannelSet::ChannelType::wideRight:
+		return getPositionFromAzimuth(60.0f, 1.0f);
+	case AudioChannelSet::ChannelType::topFrontLeft:
+		return getPositionFromAzimuth(-30.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topFrontCentre:
+		return getPositionFromAzimuth(0.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topFrontRight:
+		return getPositionFromAzimuth(30.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topSideLeft:
+		return getPositionFromAzimuth(-90.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topSideRight:
+		return getPositionFromAzimuth(90.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topRearLeft:
+		return getPositionFromAzimuth(-120.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topRearCentre:
+		return getPositionFromAzimuth(180.0f, 0.5f);
+	case AudioChannelSet::ChannelType::topRearRight:
+		return getPositionFromAzimuth(120.0f, 0.5f);
+	case AudioChannelSet::ChannelType::LFE:
+	case AudioChannelSet::ChannelType::LFE2:
+	case AudioChannelSet::ChannelType::topMiddle:
+	default:
+		// ambisonic, bottom, proximity and discrete channels have no position in the field plane
+		return s_centrePos();
+	}
+}
+
+} // namespace SurroundFieldMixer
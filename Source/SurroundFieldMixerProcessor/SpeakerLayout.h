@@ -0,0 +1,94 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "OutputLayouts.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Ordered set of speakers the matrix outputs are mapped to, one speaker per
+ * output. Layouts are created from the fixed OutputLayouts, from an
+ * AudioChannelSet, as a ring of N speakers or loaded from an xml file.
+ * Speaker coordinates are kept in a flat table, so the per speaker geometry
+ * of a source position is a single pass over contiguous memory.
+ * Positions are normalized field coordinates, the listener sits in the middle
+ * and front is at the top, azimuths are in degrees clockwise from the front.
+ */
+class SpeakerLayout
+{
+public:
+    struct Speaker
+    {
+        String              name;
+        juce::Point<float>  position;
+        bool                isLFE{ false };
+    };
+
+public:
+    SpeakerLayout();
+    ~SpeakerLayout();
+
+    //==============================================================================
+    static SpeakerLayout createFromOutputLayout(OutputLayout layout, int numGenericOutputs);
+    static SpeakerLayout createFromChannelSet(const AudioChannelSet& channelSet);
+    static SpeakerLayout createRing(int numSpeakers, float azimuthOffsetDegrees = 0.0f);
+
+    //==============================================================================
+    bool loadFromFile(const File& file);
+    bool saveToFile(const File& file) const;
+    std::unique_ptr<XmlElement> createStateXml() const;
+    bool setStateXml(const XmlElement* stateXml);
+
+    //==============================================================================
+    const String& getName() const { return m_name; };
+    void setName(const String& name);
+    int getNumSpeakers() const { return static_cast<int>(m_speakers.size()); };
+    const Speaker& getSpeaker(int speakerIdx) const;
+    juce::Point<float> getSpeakerPosition(int speakerIdx) const;
+
+    void addSpeaker(const String& name, const juce::Point<float>& position, bool isLFE = false);
+    void clear();
+
+    //==============================================================================
+    // distance of the source to every speaker, numDistances beyond the speaker count are measured to the field centre
+    void computeDistances(const juce::Point<float>& sourcePosition, float* distances, int numDistances) const;
+
+    //==============================================================================
+    static juce::Point<float> getPositionFromAzimuth(float azimuthDegrees, float distance);
+    static juce::Point<float> getDefaultPosition(AudioChannelSet::ChannelType channelType);
+
+    static constexpr juce::Point<float> s_centrePos(){return juce::Point<float>(0.5f, 0.5f);};
+
+private:
+    String                  m_name;
+    std::vector<Speaker>    m_speakers;
+    // flat copies of the speaker coordinates, kept in sync with m_speakers
+    std::vector<float>      m_speakerX;
+    std::vector<float>      m_speakerY;
+
+    JUCE_LEAK_DETECTOR(SpeakerLayout)
+};
+
+} // namespace SurroundFieldMixer
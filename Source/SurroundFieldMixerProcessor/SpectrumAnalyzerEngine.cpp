@@ -0,0 +1,159 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SpectrumAnalyzerEngine.h"
+
+namespace SurroundFieldMixer
+{
+
+SpectrumAnalyzerEngine::SpectrumAnalyzerEngine()
+{
+	m_fftData.resize(2 * s_fftSize, 0.0f);
+}
+
+SpectrumAnalyzerEngine::~SpectrumAnalyzerEngine()
+{
+}
+
+void SpectrumAnalyzerEngine::prepare(double sampleRate, int numChannels, int bandCount)
+{
+	m_sampleRate = sampleRate;
+	m_numChannels = numChannels;
+	m_bandCount = bandCount;
+
+	m_history.assign(static_cast<size_t>(m_numChannels) * s_fftSize, 0.0f);
+	m_historyWritePositions.assign(m_numChannels, 0);
+	m_samplesSinceTransform.assign(m_numChannels, 0);
+
+	calculateBandBinRanges();
+}
+
+void SpectrumAnalyzerEngine::reset()
+{
+	std::fill(m_history.begin(), m_history.end(), 0.0f);
+	std::fill(m_historyWritePositions.begin(), m_historyWritePositions.end(), 0);
+	std::fill(m_samplesSinceTransform.begin(), m_samplesSinceTransform.end(), 0);
+}
+
+void SpectrumAnalyzerEngine::calculateBandBinRanges()
+{
+	m_bandBinRanges.clear();
+	if (m_sampleRate <= 0.0)
+		return;
+
+	auto numBins = s_fftSize / 2;
+	auto binWidth = static_cast<float>(m_sampleRate) / s_fftSize;
+	auto maxFrequency = static_cast<float>(m_sampleRate) * 0.5f;
+	auto frequencyRatio = std::log(maxFrequency / s_minFrequency);
+
+	for (auto band = 0; band < m_bandCount; band++)
+	{
+		auto lowerFrequency = s_minFrequency * std::exp(frequencyRatio * band / m_bandCount);
+		auto upperFrequency = s_minFrequency * std::exp(frequencyRatio * (band + 1) / m_bandCount);
+
+		auto startBin = jlimit(1, numBins - 1, static_cast<int>(std::ceil(lowerFrequency / binWidth)));
+		auto endBin = jlimit(1, numBins, static_cast<int>(std::ceil(upperFrequency / binWidth)));
+
+		// low bands can be narrower than a single bin, those use the bin they fall into
+		if (endBin <= startBin)
+		{
+			startBin = jlimit(1, numBins - 1, static_cast<int>(lowerFrequency / binWidth));
+			endBin = startBin + 1;
+		}
+
+		m_bandBinRanges.push_back(Range<int>(startBin, endBin));
+	}
+}
+
+void SpectrumAnalyzerEngine::pushSamples(const AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+	auto numChannels = jmin(buffer.getNumChannels(), m_numChannels);
+	for (auto ch = 0; ch < numChannels; ch++)
+	{
+		auto history = m_history.data() + static_cast<size_t>(ch) * s_fftSize;
+		auto samples = buffer.getReadPointer(ch, startSample);
+		auto& writePos = m_historyWritePositions[ch];
+
+		// only the most recent s_fftSize samples are of any interest
+		auto samplesToSkip = jmax(0, numSamples - s_fftSize);
+		auto remaining = numSamples - samplesToSkip;
+		samples += samplesToSkip;
+		writePos = (writePos + samplesToSkip) % s_fftSize;
+
+		while (remaining > 0)
+		{
+			auto chunk = jmin(remaining, s_fftSize - writePos);
+			FloatVectorOperations::copy(history + writePos, samples, chunk);
+			writePos = (writePos + chunk) % s_fftSize;
+			samples += chunk;
+			remaining -= chunk;
+		}
+
+		m_samplesSinceTransform[ch] += numSamples;
+	}
+}
+
+bool SpectrumAnalyzerEngine::processPendingFrames(ProcessorSpectrumData& spectrum, float mindB, float maxdB)
+{
+	if (m_bandBinRanges.empty())
+		return false;
+
+	auto binScale = 2.0f / s_fftSize;
+	auto processedAny = false;
+
+	spectrum.SetBandCount(m_bandCount);
+	spectrum.SetRange(mindB, maxdB, s_minFrequency, static_cast<float>(m_sampleRate * 0.5), static_cast<float>(m_sampleRate / s_fftSize));
+
+	for (auto ch = 0; ch < m_numChannels; ch++)
+	{
+		if (m_samplesSinceTransform[ch] < s_hopSize)
+			continue;
+		m_samplesSinceTransform[ch] = 0;
+
+		// unwrap the channel history, oldest sample first
+		auto history = m_history.data() + static_cast<size_t>(ch) * s_fftSize;
+		auto writePos = m_historyWritePositions[ch];
+		FloatVectorOperations::copy(m_fftData.data(), history + writePos, s_fftSize - writePos);
+		FloatVectorOperations::copy(m_fftData.data() + (s_fftSize - writePos), history, writePos);
+
+		m_window.multiplyWithWindowingTable(m_fftData.data(), static_cast<size_t>(s_fftSize));
+		m_fft.performFrequencyOnlyForwardTransform(m_fftData.data());
+
+		// bands are updated in place
+		auto bandsPeak = spectrum.GetBandsPeak(ch + 1);
+		auto bandsHold = spectrum.GetBandsHold(ch + 1);
+
+		for (auto band = 0; band < static_cast<int>(m_bandBinRanges.size()); band++)
+		{
+			auto& binRange = m_bandBinRanges[band];
+			auto bandMagnitude = FloatVectorOperations::findMaximum(m_fftData.data() + binRange.getStart(), binRange.getLength()) * binScale;
+
+			auto leveldB = jlimit(mindB, maxdB, Decibels::gainToDecibels(bandMagnitude, mindB));
+			auto level = jmap(leveldB, mindB, maxdB, 0.0f, 1.0f);
+
+			bandsPeak[band] = level;
+			bandsHold[band] = std::max(level, bandsHold[band]);
+		}
+
+		processedAny = true;
+	}
+
+	return processedAny;
+}
+
+} // namespace SurroundFieldMixer
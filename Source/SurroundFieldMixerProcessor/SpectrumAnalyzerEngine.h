@@ -0,0 +1,79 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "ProcessorSpectrumData.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Multichannel spectrum analysis. Every channel keeps its own history of the
+ * last fft size samples, a windowed transform is done whenever a hop worth of
+ * new samples has arrived (50% overlap). The fft bins are aggregated into log
+ * spaced bands using a bin range table that is calculated once per samplerate.
+ * At most one transform per channel is done per processing call, so a backlog
+ * of samples does not multiply the cpu load but only skips outdated frames.
+ */
+class SpectrumAnalyzerEngine
+{
+public:
+    SpectrumAnalyzerEngine();
+    ~SpectrumAnalyzerEngine();
+
+    //==============================================================================
+    void prepare(double sampleRate, int numChannels, int bandCount);
+    void reset();
+
+    //==============================================================================
+    void pushSamples(const AudioBuffer<float>& buffer, int startSample, int numSamples);
+    bool processPendingFrames(ProcessorSpectrumData& spectrum, float mindB, float maxdB);
+
+    //==============================================================================
+    static constexpr int s_fftOrder = 11;
+    static constexpr int s_fftSize = 1 << s_fftOrder;
+    static constexpr int s_hopSize = s_fftSize / 2;
+    static constexpr int s_defaultBandCount = 64;
+    static constexpr int s_maxBandCount = 256;
+    static constexpr float s_minFrequency = 20.0f;
+
+private:
+    void calculateBandBinRanges();
+
+    dsp::FFT                        m_fft{ s_fftOrder };
+    dsp::WindowingFunction<float>   m_window{ static_cast<size_t>(s_fftSize), dsp::WindowingFunction<float>::hann };
+
+    double                          m_sampleRate{ 0.0 };
+    int                             m_numChannels{ 0 };
+    int                             m_bandCount{ s_defaultBandCount };
+
+    std::vector<float>              m_history;              // m_numChannels x s_fftSize ring buffers
+    std::vector<int>                m_historyWritePositions;
+    std::vector<int>                m_samplesSinceTransform;
+    std::vector<float>              m_fftData;              // 2 x s_fftSize as required by dsp::FFT
+    std::vector<Range<int>>         m_bandBinRanges;        // inclusive start, exclusive end bin per band
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzerEngine)
+};
+
+} // namespace SurroundFieldMixer
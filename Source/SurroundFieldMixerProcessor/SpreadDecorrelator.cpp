@@ -0,0 +1,154 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SpreadDecorrelator.h"
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+SpreadDecorrelator::SpreadDecorrelator()
+{
+}
+
+SpreadDecorrelator::~SpreadDecorrelator()
+{
+}
+
+void SpreadDecorrelator::prepare(int maxNumInputs, int maxSamplesPerBlock, AudioMemoryArena& memory)
+{
+	// the arena hands out zeroed memory, so all filters start silent
+	m_maxNumInputs = maxNumInputs;
+	m_maxSamplesPerBlock = maxSamplesPerBlock;
+	m_inputRuns.assign(static_cast<size_t>(maxNumInputs), InputRun());
+	m_numInputRuns = 0;
+	m_frames = memory.take(static_cast<size_t>(maxSamplesPerBlock) * maxNumInputs);
+	for (auto stageIdx = 0; stageIdx < s_numStages; stageIdx++)
+	{
+		m_stageStates[stageIdx] = memory.take(static_cast<size_t>(s_stageLengths[stageIdx]) * maxNumInputs);
+		m_stagePositions[stageIdx] = 0;
+	}
+
+	if (m_frames == nullptr || std::find(std::begin(m_stageStates), std::end(m_stageStates), nullptr) != std::end(m_stageStates))
+		release();
+}
+
+void SpreadDecorrelator::release()
+{
+	m_maxNumInputs = 0;
+	m_maxSamplesPerBlock = 0;
+	m_numInputRuns = 0;
+	m_frames = nullptr;
+	for (auto stageIdx = 0; stageIdx < s_numStages; stageIdx++)
+	{
+		m_stageStates[stageIdx] = nullptr;
+		m_stagePositions[stageIdx] = 0;
+	}
+}
+
+void SpreadDecorrelator::reset(int inputIdx)
+{
+	if (inputIdx < 0 || inputIdx >= m_maxNumInputs)
+		return;
+
+	for (auto stageIdx = 0; stageIdx < s_numStages; stageIdx++)
+	{
+		auto state = m_stageStates[stageIdx] + inputIdx;
+		for (auto i = 0; i < s_stageLengths[stageIdx]; i++)
+			state[static_cast<size_t>(i) * m_maxNumInputs] = 0.0f;
+	}
+}
+
+template <typename SampleType>
+void SpreadDecorrelator::process(const SampleType* const* inputs, SampleType* const* outputs, const int* inputIndices, int numInputIndices, int numSamples)
+{
+	numSamples = jmin(numSamples, m_maxSamplesPerBlock);
+	if (m_frames == nullptr || numInputIndices <= 0 || numSamples <= 0)
+		return;
+
+	// the selected inputs are packed into the frames in their given order, runs of consecutive inputs share one filter pass
+	jassert(numInputIndices <= m_maxNumInputs);
+	numInputIndices = jmin(numInputIndices, m_maxNumInputs);
+	m_numInputRuns = 0;
+	for (auto slot = 0; slot < numInputIndices; slot++)
+	{
+		auto inputIdx = inputIndices[slot];
+		jassert(inputIdx >= 0 && inputIdx < m_maxNumInputs);
+		if (m_numInputRuns > 0 && m_inputRuns[m_numInputRuns - 1].firstInputIdx + m_inputRuns[m_numInputRuns - 1].numInputs == inputIdx)
+			m_inputRuns[m_numInputRuns - 1].numInputs++;
+		else
+			m_inputRuns[m_numInputRuns++] = { inputIdx, 1, slot };
+	}
+
+	for (auto slot = 0; slot < numInputIndices; slot++)
+	{
+		auto input = inputs[inputIndices[slot]];
+		auto frame = m_frames + slot;
+		for (auto i = 0; i < numSamples; i++)
+			frame[i * numInputIndices] = static_cast<float>(input[i]);
+	}
+
+	// v[n] = x[n] + g * v[n - M], y[n] = v[n - M] - g * v[n], for all inputs of a run at once
+	auto g = s_stageCoefficient;
+	for (auto i = 0; i < numSamples; i++)
+	{
+		auto frame = m_frames + static_cast<size_t>(i) * numInputIndices;
+		for (auto stageIdx = 0; stageIdx < s_numStages; stageIdx++)
+		{
+			auto stageState = m_stageStates[stageIdx] + static_cast<size_t>(m_stagePositions[stageIdx]) * m_maxNumInputs;
+			for (auto runIdx = 0; runIdx < m_numInputRuns; runIdx++)
+			{
+				auto const& run = m_inputRuns[runIdx];
+				auto state = stageState + run.firstInputIdx;
+				auto runFrame = frame + run.firstFrameSlot;
+				for (auto j = 0; j < run.numInputs; j++)
+				{
+					auto delayed = state[j];
+					auto v = runFrame[j] + g * delayed;
+					runFrame[j] = delayed - g * v;
+					state[j] = flushDenormal(v);
+				}
+			}
+
+			if (++m_stagePositions[stageIdx] == s_stageLengths[stageIdx])
+				m_stagePositions[stageIdx] = 0;
+		}
+	}
+
+	for (auto slot = 0; slot < numInputIndices; slot++)
+	{
+		auto output = outputs[inputIndices[slot]];
+		auto frame = m_frames + slot;
+		for (auto i = 0; i < numSamples; i++)
+			output[i] = static_cast<SampleType>(frame[i * numInputIndices]);
+	}
+}
+
+template void SpreadDecorrelator::process<float>(const float* const* inputs, float* const* outputs, const int* inputIndices, int numInputIndices, int numSamples);
+template void SpreadDecorrelator::process<double>(const double* const* inputs, double* const* outputs, const int* inputIndices, int numInputIndices, int numSamples);
+
+size_t SpreadDecorrelator::getRequiredMemorySize(int maxNumInputs, int maxSamplesPerBlock)
+{
+	auto size = AudioMemoryArena::getPaddedSize(static_cast<size_t>(maxSamplesPerBlock) * maxNumInputs);
+	for (auto stageLength : s_stageLengths)
+		size += AudioMemoryArena::getPaddedSize(static_cast<size_t>(stageLength) * maxNumInputs);
+
+	return size;
+}
+
+} // namespace SurroundFieldMixer
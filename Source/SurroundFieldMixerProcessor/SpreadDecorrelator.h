@@ -0,0 +1,84 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "AudioMemoryArena.h"
+#include "DenormalFlush.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Short chain of Schroeder all-pass filters that produces a decorrelated copy
+ * of selected inputs. All inputs share the same filter lengths, so the filter
+ * state is kept interleaved by input and every filter step is one pass over
+ * each run of consecutive selected inputs, which vectorizes across inputs.
+ * Blocks are transposed into that layout on the way in and back on the way out.
+ * The filter state is flushed with flushDenormal (see DenormalFlush.h).
+ */
+class SpreadDecorrelator
+{
+public:
+    SpreadDecorrelator();
+    ~SpreadDecorrelator();
+
+    //==============================================================================
+    void prepare(int maxNumInputs, int maxSamplesPerBlock, AudioMemoryArena& memory);
+    void release();
+
+    //==============================================================================
+    // decorrelates the given inputs (ascending indices into inputs and outputs) into outputs, channels are processed in single precision
+    template <typename SampleType>
+    void process(const SampleType* const* inputs, SampleType* const* outputs, const int* inputIndices, int numInputIndices, int numSamples);
+    // clears the filter state of an input, so it starts from silence the next time it is processed
+    void reset(int inputIdx);
+
+    //==============================================================================
+    static size_t getRequiredMemorySize(int maxNumInputs, int maxSamplesPerBlock);
+
+    static constexpr int s_numStages = 4;
+    static constexpr int s_stageLengths[s_numStages] = { 31, 73, 139, 227 }; // mutually prime, about 10ms in total at 48kHz
+    static constexpr float s_stageCoefficient = 0.6f;
+    static constexpr int s_tailLength = 8192; // samples until an impulse has decayed below -120dB
+
+private:
+    // consecutive selected inputs, their filter state and their frame slots are both contiguous
+    struct InputRun
+    {
+        int firstInputIdx{ 0 };
+        int numInputs{ 0 };
+        int firstFrameSlot{ 0 };
+    };
+
+    int                 m_maxNumInputs{ 0 };
+    int                 m_maxSamplesPerBlock{ 0 };
+    std::vector<InputRun>   m_inputRuns;                  // one slot per input, sized in prepare
+    int                 m_numInputRuns{ 0 };
+    float*              m_frames{ nullptr };                // numSamples x selected inputs, interleaved by input
+    float*              m_stageStates[s_numStages]{};       // stage length x max inputs, interleaved by input
+    int                 m_stagePositions[s_numStages]{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpreadDecorrelator)
+};
+
+} // namespace SurroundFieldMixer
@@ -271,19 +271,10 @@ void SurroundFieldMixerProcessor::OutputCommander::outputSchemePoll()
 SurroundFieldMixerProcessor::SurroundFieldMixerProcessor() :
 	AudioProcessor()
 {
-	// prepare max sized processing data buffer
-	m_processorChannels = new float* [s_maxChannelCount];
-	for (auto channel = 0; channel < s_maxChannelCount; channel++)
-	{
-		m_processorChannels[channel] = new float[s_maxNumSamples];
-		for (auto sample = 0; sample < s_maxNumSamples; sample++)
-		{
-			m_processorChannels[channel][sample] = 0.0f;
-		}
-	}
-
 	m_inputDataAnalyzer = std::make_unique<ProcessorDataAnalyzer>();
+	m_inputDataAnalyzer->addListener(this);
 	m_outputDataAnalyzer = std::make_unique<ProcessorDataAnalyzer>();
+	m_outputDataAnalyzer->addListener(this);
 
 	m_deviceManager = std::make_unique<AudioDeviceManager>();
 	m_deviceManager->addAudioCallback(this);
@@ -305,24 +296,27 @@ SurroundFieldMixerProcessor::SurroundFieldMixerProcessor() :
 	m_deviceManager->setAudioDeviceSetup(audioDeviceSetup, true);
 
 
-	auto orig = s_defaultPos();
-	auto a = 0.5f * sinf(juce::MathConstants<float>::pi / 6); // pi * (30/180)
-	auto b = 0.5f * sinf(juce::MathConstants<float>::pi / 3); // pi * (60/180)
-	m_leftPos = orig + juce::Point<float>(-a, b);
-	m_rightPos = orig + juce::Point<float>(a, b);
-	m_centerPos = orig + juce::Point<float>(0.f, 0.5f);
-	m_leftSurroundPos = orig + juce::Point<float>(-b, -a);
-	m_rightSurroundPos = orig + juce::Point<float>(b, -a);
+	m_gainFieldGridBuilder.setBuildCallback([this](std::unique_ptr<GainFieldGrid> grid, uint32 requestId) {
+		const ScopedLock sl(m_readLock);
+		// a grid built for an outdated layout or panning law is dropped
+		if (requestId != m_gainFieldGridRequestId || !m_gainFieldGridEnabled)
+			return;
+
+		m_gainFieldGrid = std::move(grid);
+		updateAllInputToOutputGains();
+		publishParameters();
+	});
+
+	{
+		const ScopedLock sl(m_readLock);
+		applySpeakerLayout(SpeakerLayout::createFromOutputLayout(m_outputLayout, s_minOutputsCount));
+	}
 }
 
 SurroundFieldMixerProcessor::~SurroundFieldMixerProcessor()
 {
+	m_gainFieldGridBuilder.stop();
 	m_deviceManager->removeAudioCallback(this);
-
-	// cleanup processing data buffer (do this elsewhere in productive code to avoid excessive mem alloc/free)
-	for (auto i = 0; i < s_maxChannelCount; i++)
-		delete[] m_processorChannels[i];
-	delete[] m_processorChannels;
 }
 
 void SurroundFieldMixerProcessor::addInputListener(ProcessorDataAnalyzer::Listener* listener)
@@ -470,6 +464,10 @@ void SurroundFieldMixerProcessor::setInputMuteState(int inputChannelNumber, bool
 
 	const ScopedLock sl(m_readLock);
 	m_inputMuteStates[inputChannelNumber] = muted;
+
+	setParameterInputCount(inputChannelNumber);
+	m_parameters.inputMutes[inputChannelNumber - 1] = muted;
+	publishParameters();
 }
 
 float SurroundFieldMixerProcessor::getInputGainValue(int inputChannelNumber)
@@ -491,6 +489,10 @@ void SurroundFieldMixerProcessor::setInputGainValue(int inputChannelNumber, floa
 
 	const ScopedLock sl(m_readLock);
 	m_inputGainValues[inputChannelNumber] = value;
+
+	setParameterInputCount(inputChannelNumber);
+	m_parameters.inputGains[inputChannelNumber - 1] = value;
+	publishParameters();
 }
 
 float SurroundFieldMixerProcessor::getInputReverbValue(int inputChannelNumber)
@@ -512,6 +514,10 @@ void SurroundFieldMixerProcessor::setInputReverbValue(int inputChannelNumber, fl
 
 	const ScopedLock sl(m_readLock);
 	m_inputReverbValues[inputChannelNumber] = value;
+
+	setParameterInputCount(inputChannelNumber);
+	m_parameters.inputReverbs[inputChannelNumber - 1] = value;
+	publishParameters();
 }
 
 float SurroundFieldMixerProcessor::getInputSpreadValue(int inputChannelNumber)
@@ -533,6 +539,11 @@ void SurroundFieldMixerProcessor::setInputSpreadValue(int inputChannelNumber, fl
 
 	const ScopedLock sl(m_readLock);
 	m_inputSpreadValues[inputChannelNumber] = value;
+
+	setParameterInputCount(inputChannelNumber);
+	m_parameters.inputSpreads[inputChannelNumber - 1] = value;
+	updateInputToOutputGains(inputChannelNumber - 1);
+	publishParameters();
 }
 
 bool SurroundFieldMixerProcessor::getOutputMuteState(int outputChannelNumber)
@@ -554,6 +565,10 @@ void SurroundFieldMixerProcessor::setOutputMuteState(int outputChannelNumber, bo
 
 	const ScopedLock sl(m_readLock);
 	m_outputMuteStates[outputChannelNumber] = muted;
+
+	setParameterOutputCount(outputChannelNumber);
+	m_parameters.outputMutes[outputChannelNumber - 1] = muted;
+	publishParameters();
 }
 
 float SurroundFieldMixerProcessor::getOutputGainValue(int outputChannelNumber)
@@ -575,6 +590,10 @@ void SurroundFieldMixerProcessor::setOutputGainValue(int outputChannelNumber, fl
 
 	const ScopedLock sl(m_readLock);
 	m_outputGainValues[outputChannelNumber] = value;
+
+	setParameterOutputCount(outputChannelNumber);
+	m_parameters.outputGains[outputChannelNumber - 1] = value;
+	publishParameters();
 }
 
 const juce::Point<float>& SurroundFieldMixerProcessor::getInputPositionValue(int inputChannelNumber)
@@ -596,407 +615,1887 @@ void SurroundFieldMixerProcessor::setInputPositionValue(int inputChannelNumber,
 
 	const ScopedLock sl(m_readLock);
 	m_inputPositionValues[inputChannelNumber] = position;
+
+	setParameterInputCount(inputChannelNumber);
+	m_parameters.inputPositions[inputChannelNumber - 1] = position;
+	updateInputToOutputGains(inputChannelNumber - 1);
+	publishParameters();
 }
 
-AudioDeviceManager* SurroundFieldMixerProcessor::getDeviceManager()
+bool SurroundFieldMixerProcessor::getDelayEnabled()
 {
-	if (m_deviceManager)
-		return m_deviceManager.get();
-	else
-		return nullptr;
+	const ScopedLock sl(m_readLock);
+	return m_parameters.delayEnabled;
 }
 
-//==============================================================================
-const String SurroundFieldMixerProcessor::getName() const
+void SurroundFieldMixerProcessor::setDelayEnabled(bool enabled)
 {
-	return m_Name;
+	const ScopedLock sl(m_readLock);
+	m_parameters.delayEnabled = enabled;
+	publishParameters();
 }
 
-void SurroundFieldMixerProcessor::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+OutputLayout SurroundFieldMixerProcessor::getOutputLayout()
 {
-	if (m_inputDataAnalyzer)
-		m_inputDataAnalyzer->initializeParameters(sampleRate, maximumExpectedSamplesPerBlock);
-	if (m_outputDataAnalyzer)
-		m_outputDataAnalyzer->initializeParameters(sampleRate, maximumExpectedSamplesPerBlock);
+	const ScopedLock sl(m_readLock);
+	return m_outputLayout;
 }
 
-void SurroundFieldMixerProcessor::releaseResources()
+void SurroundFieldMixerProcessor::setOutputLayout(OutputLayout layout)
 {
-	if (m_inputDataAnalyzer)
-		m_inputDataAnalyzer->clearParameters();
-	if (m_outputDataAnalyzer)
-		m_outputDataAnalyzer->clearParameters();
+	const ScopedLock sl(m_readLock);
+	m_outputLayout = layout;
+
+	// the fixed layouts bring their own output count, the generic layout keeps the current one
+	applySpeakerLayout(SpeakerLayout::createFromOutputLayout(layout, m_parameters.getMatrixOutputCount()));
 }
 
-void SurroundFieldMixerProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+PanningLaw SurroundFieldMixerProcessor::getPanningLaw()
 {
-	ignoreUnused(midiMessages);
+	const ScopedLock sl(m_readLock);
+	return m_panningLaw;
+}
 
-	// the lock is currently gloablly taken in audioDeviceIOCallback which is calling this method
-	//const ScopedLock sl(m_readLock);
+void SurroundFieldMixerProcessor::setPanningLaw(PanningLaw panningLaw)
+{
+	const ScopedLock sl(m_readLock);
+	if (m_panningLaw == panningLaw)
+		return;
 
-	auto inputChannels = buffer.getNumChannels();
-	auto outputChannels = s_minOutputsCount;
+	m_panningLaw = panningLaw;
+	requestGainFieldGrid();
+	updateAllInputToOutputGains();
+	publishParameters();
+}
 
-	jassert(inputChannels <= m_inputMuteStates.size());
-	for (auto input = 1; input <= inputChannels; input++)
-	{
-		if (m_inputMuteStates[input])
-		{
-			auto channelIdx = input - 1;
-			buffer.clear(channelIdx, 0, buffer.getNumSamples());
-		}
-	}
+SpeakerLayout SurroundFieldMixerProcessor::getSpeakerLayout()
+{
+	const ScopedLock sl(m_readLock);
+	return m_speakerLayout;
+}
 
-	jassert(inputChannels <= m_inputGainValues.size());
-	for (auto input = 1; input <= inputChannels; input++)
-	{
-		auto channelIdx = input - 1;
-		auto& gainValue = m_inputGainValues[input];
-		buffer.applyGain(channelIdx, 0, buffer.getNumSamples(), gainValue);
-	}
+void SurroundFieldMixerProcessor::setSpeakerLayout(const SpeakerLayout& speakerLayout)
+{
+	const ScopedLock sl(m_readLock);
+	m_outputLayout = OutputLayout::Generic;
+	applySpeakerLayout(speakerLayout);
+}
 
-	postMessage(new AudioInputBufferMessage(buffer));
+bool SurroundFieldMixerProcessor::loadSpeakerLayout(const File& file)
+{
+	// the file is parsed before taking the lock, so the control side is only held up for the gain table update
+	SpeakerLayout speakerLayout;
+	if (!speakerLayout.loadFromFile(file))
+		return false;
 
-	// process data in buffer to be what shall be used as output
-	AudioBuffer<float> processedBuffer;
-	processedBuffer.setSize(outputChannels, buffer.getNumSamples(), false, true, true);
-	for (auto inputIdx = 0; inputIdx < inputChannels; inputIdx++)
-	{
-		for (auto outputIdx = 0; outputIdx < outputChannels; outputIdx++)
-		{
-			auto gain = getInputToOutputGain(inputIdx + 1, outputIdx + 1);
-			processedBuffer.addFrom(outputIdx, 0, buffer.getReadPointer(inputIdx), buffer.getNumSamples(), gain);
-		}
-	}
-	buffer.makeCopyOf(processedBuffer, true);
+	setSpeakerLayout(speakerLayout);
+	return true;
+}
 
-	jassert(outputChannels <= m_outputMuteStates.size());
-	for (auto output = 1; output <= outputChannels; output++)
-	{
-		if (m_outputMuteStates[output])
-		{
-			auto channelIdx = output - 1;
-			buffer.clear(channelIdx, 0, buffer.getNumSamples());
-		}
-	}
+void SurroundFieldMixerProcessor::applySpeakerLayout(const SpeakerLayout& speakerLayout)
+{
+	// m_readLock is expected to be held by the caller. The audio thread keeps rendering the previous snapshot
+	// until the gain rows for the new layout are published, the cell gain ramps then glide over to them.
+	jassert(speakerLayout.getNumSpeakers() > 0);
+	if (speakerLayout.getNumSpeakers() == 0)
+		return;
+
+	m_speakerLayout = speakerLayout;
+	m_vbapPanner.setSpeakerLayout(m_speakerLayout);
+	requestGainFieldGrid();
+	setParameterMatrixOutputCount(jmin(m_speakerLayout.getNumSpeakers(), s_maxChannelCount));
+	m_parameters.outputLayout = m_outputLayout;
+	publishParameters();
+}
+
+bool SurroundFieldMixerProcessor::getGainFieldGridEnabled()
+{
+	const ScopedLock sl(m_readLock);
+	return m_gainFieldGridEnabled;
+}
+
+void SurroundFieldMixerProcessor::setGainFieldGridEnabled(bool enabled)
+{
+	// the gains stay directly calculated until the grid has been built in the background
+	const ScopedLock sl(m_readLock);
+	if (m_gainFieldGridEnabled == enabled)
+		return;
 
-	jassert(outputChannels <= m_outputGainValues.size());
-	for (auto output = 1; output <= outputChannels; output++)
+	m_gainFieldGridEnabled = enabled;
+	requestGainFieldGrid();
+	if (!enabled)
 	{
-		auto channelIdx = output - 1;
-		auto& gainValue = m_outputGainValues[output];
-		buffer.applyGain(channelIdx, 0, buffer.getNumSamples(), gainValue);
+		updateAllInputToOutputGains();
+		publishParameters();
 	}
+}
 
-	postMessage(new AudioOutputBufferMessage(buffer));
+bool SurroundFieldMixerProcessor::getSpreadDecorrelationEnabled()
+{
+	const ScopedLock sl(m_readLock);
+	return m_parameters.spreadDecorrelationEnabled;
 }
 
-float SurroundFieldMixerProcessor::getInputToOutputGain(int input, int output)
+void SurroundFieldMixerProcessor::setSpreadDecorrelationEnabled(bool enabled)
 {
-	auto inputPos = getInputPosition(input);
-	auto outputPos = getOutputPosition(output);
-
-	//if (input == 1)
-	//{
-	//	DBG(String(__FUNCTION__) << " i:o=" << input << ":" << output << "(inputPos:" << inputPos.toString() << "; outputPos:" << outputPos.toString() << ")");
-	//	DBG(String(__FUNCTION__) << " i:o=" << input << ":" << output << " resulting in dist " << inputPos.getDistanceFrom(outputPos));
-	//}
-
-	return 1.0f - inputPos.getDistanceFrom(outputPos);
-}
-
-const juce::Point<float> SurroundFieldMixerProcessor::getInputPosition(int channelNumber)
-{
-	return getInputPositionValue(channelNumber);
-}
-
-const juce::Point<float> SurroundFieldMixerProcessor::getOutputPosition(int channelNumber)
-{
-	jassert(channelNumber > 0);
-	switch (channelNumber)
-	{
-	case 1: // L
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::left);
-	case 2: // C
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::centre);
-	case 3: // R
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::right);
-	case 4: // RS
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::rightSurround);
-	case 5: // LS
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::leftSurround);
-	case 6: // LFE
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::LFE);
-	default:
-		return getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType::unknown);
-	}
-}
-
-const juce::Point<float> SurroundFieldMixerProcessor::getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType channelIdent)
-{
-	switch (channelIdent)
-	{
-	case juce::AudioChannelSet::ChannelType::left:
-		return m_leftPos;
-	case juce::AudioChannelSet::ChannelType::right:
-		return m_rightPos;
-	case juce::AudioChannelSet::ChannelType::centre:
-		return m_centerPos;
-	case juce::AudioChannelSet::ChannelType::LFE:
-		return s_defaultPos();
-	case juce::AudioChannelSet::ChannelType::leftSurround:
-		return m_leftSurroundPos;
-	case juce::AudioChannelSet::ChannelType::rightSurround:
-		return m_rightSurroundPos;
-	case juce::AudioChannelSet::ChannelType::leftCentre:
-	case juce::AudioChannelSet::ChannelType::rightCentre:
-	case juce::AudioChannelSet::ChannelType::centreSurround:
-	case juce::AudioChannelSet::ChannelType::leftSurroundSide:
-	case juce::AudioChannelSet::ChannelType::rightSurroundSide:
-	case juce::AudioChannelSet::ChannelType::topMiddle:
-	case juce::AudioChannelSet::ChannelType::topFrontLeft:
-	case juce::AudioChannelSet::ChannelType::topFrontCentre:
-	case juce::AudioChannelSet::ChannelType::topFrontRight:
-	case juce::AudioChannelSet::ChannelType::topRearLeft:
-	case juce::AudioChannelSet::ChannelType::topRearCentre:
-	case juce::AudioChannelSet::ChannelType::topRearRight:
-	case juce::AudioChannelSet::ChannelType::LFE2:
-	case juce::AudioChannelSet::ChannelType::leftSurroundRear:
-	case juce::AudioChannelSet::ChannelType::rightSurroundRear:
-	case juce::AudioChannelSet::ChannelType::wideLeft:
-	case juce::AudioChannelSet::ChannelType::wideRight:
-	case juce::AudioChannelSet::ChannelType::topSideLeft:
-	case juce::AudioChannelSet::ChannelType::topSideRight:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN0:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN1: 
-	case juce::AudioChannelSet::ChannelType::ambisonicACN2:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN3: 
-	case juce::AudioChannelSet::ChannelType::ambisonicACN4:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN5:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN6: 
-	case juce::AudioChannelSet::ChannelType::ambisonicACN7: 
-	case juce::AudioChannelSet::ChannelType::ambisonicACN8:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN9:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN10:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN11:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN12:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN13:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN14:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN15:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN16:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN17:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN18:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN19:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN20:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN21:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN22:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN23:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN24:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN25:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN26:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN27:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN28:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN29:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN30:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN31:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN32:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN33:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN34:
-	case juce::AudioChannelSet::ChannelType::ambisonicACN35:
-	case juce::AudioChannelSet::ChannelType::bottomFrontLeft:
-	case juce::AudioChannelSet::ChannelType::bottomFrontCentre:
-	case juce::AudioChannelSet::ChannelType::bottomFrontRight:
-	case juce::AudioChannelSet::ChannelType::proximityLeft:
-	case juce::AudioChannelSet::ChannelType::proximityRight:
-	case juce::AudioChannelSet::ChannelType::bottomSideLeft:
-	case juce::AudioChannelSet::ChannelType::bottomSideRight:
-	case juce::AudioChannelSet::ChannelType::bottomRearLeft:
-	case juce::AudioChannelSet::ChannelType::bottomRearCentre:
-	case juce::AudioChannelSet::ChannelType::bottomRearRight:
-	case juce::AudioChannelSet::ChannelType::discreteChannel0:
-	case juce::AudioChannelSet::ChannelType::unknown:
-	default:
-		return s_defaultPos();
-	}
-}
-
-void SurroundFieldMixerProcessor::handleMessage(const Message& message)
-{
-	if (auto m = dynamic_cast<const AudioBufferMessage*> (&message))
-	{
-		if (m->getFlowDirection() == AudioBufferMessage::FlowDirection::Input && m_inputDataAnalyzer)
-		{
-			m_inputDataAnalyzer->analyzeData(m->getAudioBuffer());
-
-			for (auto const& inputCommander : m_inputCommanders)
-			{
-				auto levelData = m_inputDataAnalyzer->GetLevel();
-				auto channelCount = levelData.GetChannelCount();
-				for (std::uint16_t i = 1; i < channelCount+1; i++)
-					inputCommander->setInputLevel(i, levelData.GetLevel(i).GetFactorRMSdB());
-			}
-		}
-		else if (m->getFlowDirection() == AudioBufferMessage::FlowDirection::Output && m_outputDataAnalyzer)
-		{
-			m_outputDataAnalyzer->analyzeData(m->getAudioBuffer());
+	const ScopedLock sl(m_readLock);
+	if (m_parameters.spreadDecorrelationEnabled == enabled)
+		return;
 
-			for (auto const& outputCommander : m_outputCommanders)
-			{
-				auto levelData = m_outputDataAnalyzer->GetLevel();
-				auto channelCount = levelData.GetChannelCount();
-				for (std::uint16_t i = 1; i < channelCount + 1; i++)
-					outputCommander->setOutputLevel(i, levelData.GetLevel(i).GetFactorRMSdB());
-			}
-		}
-	}
+	m_parameters.spreadDecorrelationEnabled = enabled;
+	updateAllInputToOutputGains();
+	publishParameters();
 }
 
-double SurroundFieldMixerProcessor::getTailLengthSeconds() const
+bool SurroundFieldMixerProcessor::getReverbEnabled()
 {
-	/*dbg*/return 0.0;
+	const ScopedLock sl(m_readLock);
+	return m_parameters.reverbEnabled;
 }
 
-bool SurroundFieldMixerProcessor::acceptsMidi() const
+void SurroundFieldMixerProcessor::setReverbEnabled(bool enabled)
 {
-	return false;
+	// the input reverb values only send to the shared reverb while it is enabled, the tail fades out after switching off
+	const ScopedLock sl(m_readLock);
+	m_parameters.reverbEnabled = enabled;
+	publishParameters();
 }
 
-bool SurroundFieldMixerProcessor::producesMidi() const
+void SurroundFieldMixerProcessor::requestGainFieldGrid()
 {
-	return false;
+	// m_readLock is expected to be held by the caller. The current grid belongs to the previous layout or panning law,
+	// until the new one is built the gains are calculated directly again.
+	m_gainFieldGridRequestId++;
+	m_gainFieldGrid.reset();
+	if (!m_gainFieldGridEnabled)
+		return;
+
+	// the builder works on its own copies, so it never touches anything guarded by m_readLock
+	auto speakerLayout = std::make_shared<SpeakerLayout>(m_speakerLayout);
+	auto vbapPanner = std::make_shared<VBAPPanner>();
+	vbapPanner->setSpeakerLayout(*speakerLayout);
+	auto panningLaw = m_panningLaw;
+	m_gainFieldGridBuilder.requestBuild(GainFieldGrid::s_defaultResolution, jmin(speakerLayout->getNumSpeakers(), s_maxChannelCount),
+		[=](const juce::Point<float>& position, float* gains, int numGains) {
+			computePanningGains(panningLaw, *speakerLayout, *vbapPanner, position, gains, numGains);
+		}, m_gainFieldGridRequestId);
 }
 
-AudioProcessorEditor* SurroundFieldMixerProcessor::createEditor()
+int SurroundFieldMixerProcessor::getRenderWorkerCount()
 {
-	if (!m_processorEditor)
-		m_processorEditor = std::make_unique<SurroundFieldMixerEditor>(this);
+	const ScopedLock sl(m_readLock);
+	return m_renderWorkerCount;
+}
 
-	return m_processorEditor.get();
+void SurroundFieldMixerProcessor::setRenderWorkerCount(int workerCount)
+{
+	// takes effect with the next prepareToPlay, 0 renders single threaded, -1 picks a count from the available cpus
+	const ScopedLock sl(m_readLock);
+	m_renderWorkerCount = jmin(workerCount, s_maxRenderWorkerCount);
 }
 
-bool SurroundFieldMixerProcessor::hasEditor() const
+bool SurroundFieldMixerProcessor::getAudioMemoryLockEnabled()
 {
-	return !!m_processorEditor;
+	const ScopedLock sl(m_readLock);
+	return m_audioMemoryLockEnabled;
 }
 
-int SurroundFieldMixerProcessor::getNumPrograms()
+void SurroundFieldMixerProcessor::setAudioMemoryLockEnabled(bool enabled)
 {
-	/*dbg*/return 0;
+	// takes effect with the next prepareToPlay, locking may fail silently if the os limits do not allow it
+	const ScopedLock sl(m_readLock);
+	m_audioMemoryLockEnabled = enabled;
 }
 
-int SurroundFieldMixerProcessor::getCurrentProgram()
+bool SurroundFieldMixerProcessor::getDoublePrecisionEnabled()
 {
-	/*dbg*/return 0;
+	return isUsingDoublePrecision();
 }
 
-void SurroundFieldMixerProcessor::setCurrentProgram(int index)
+void SurroundFieldMixerProcessor::setDoublePrecisionEnabled(bool enabled)
 {
-	/*dbg*/ignoreUnused(index);
+	// takes effect with the next prepareToPlay. Device callbacks are converted to double and back around the render path,
+	// hosts hand in double buffers directly.
+	setProcessingPrecision(enabled ? AudioProcessor::doublePrecision : AudioProcessor::singlePrecision);
 }
 
-const String SurroundFieldMixerProcessor::getProgramName(int index)
+String SurroundFieldMixerProcessor::getMixKernelInstructionSetName() const
 {
-	/*dbg*/ignoreUnused(index);
-	/*dbg*/return String();
+	// picked once when the kernel is constructed, so there is nothing to lock
+	return MatrixMixKernel::getInstructionSetName(m_mixKernel.getInstructionSet());
 }
 
-void SurroundFieldMixerProcessor::changeProgramName(int index, const String& newName)
+void SurroundFieldMixerProcessor::setParameterInputCount(int minimumInputCount)
 {
-	/*dbg*/ignoreUnused(index);
-	/*dbg*/ignoreUnused(newName);
+	auto previousInputCount = m_parameters.getInputCount();
+	if (minimumInputCount <= previousInputCount)
+		return;
+
+	m_parameters.setInputCount(minimumInputCount);
+	for (auto inputIdx = previousInputCount; inputIdx < minimumInputCount; inputIdx++)
+		updateInputToOutputGains(inputIdx);
 }
 
-void SurroundFieldMixerProcessor::getStateInformation(juce::MemoryBlock& destData)
+void SurroundFieldMixerProcessor::setParameterOutputCount(int minimumOutputCount)
 {
-	/*dbg*/ignoreUnused(destData);
+	if (minimumOutputCount > m_parameters.getOutputCount())
+		m_parameters.setOutputCount(minimumOutputCount);
 }
 
-void SurroundFieldMixerProcessor::setStateInformation(const void* data, int sizeInBytes)
+void SurroundFieldMixerProcessor::setParameterMatrixOutputCount(int matrixOutputCount)
 {
-	/*dbg*/ignoreUnused(data);
-	/*dbg*/ignoreUnused(sizeInBytes);
+	m_parameters.setMatrixOutputCount(matrixOutputCount);
+	for (auto inputIdx = 0; inputIdx < m_parameters.getInputCount(); inputIdx++)
+		updateInputToOutputGains(inputIdx);
+
+	// the reverb return is spread evenly over the full range speakers, its total level does not depend on their number
+	auto isFullRangeOutput = [this](int outputIdx) { return outputIdx < m_speakerLayout.getNumSpeakers() && !m_speakerLayout.getSpeaker(outputIdx).isLFE; };
+	auto numFullRangeOutputs = 0;
+	for (auto outputIdx = 0; outputIdx < matrixOutputCount; outputIdx++)
+		numFullRangeOutputs += isFullRangeOutput(outputIdx) ? 1 : 0;
+	for (auto outputIdx = 0; outputIdx < matrixOutputCount; outputIdx++)
+		m_parameters.reverbOutputGains[outputIdx] = isFullRangeOutput(outputIdx) ? 1.0f / std::sqrt(static_cast<float>(numFullRangeOutputs)) : 0.0f;
 }
 
-void SurroundFieldMixerProcessor::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
-	float* const* outputChannelData, int numOutputChannels, int numSamples, const AudioIODeviceCallbackContext& context)
+void SurroundFieldMixerProcessor::updateInputToOutputGains(int inputIdx)
 {
-    ignoreUnused(context);
-    
-	const ScopedLock sl(m_readLock);
+	// only recalculated when position, spread, speaker layout or panning law change, processBlock just reads the cached rows.
+	// One pass over the speaker table gives the distances both gain and delay are derived from.
+	auto& inputPosition = m_parameters.inputPositions[inputIdx];
+	auto numOutputs = m_parameters.getMatrixOutputCount();
+	auto gains = m_parameters.getInputToOutputGains(inputIdx);
+	auto delays = m_parameters.getInputToOutputDelays(inputIdx);
+	m_speakerLayout.computeDistances(inputPosition, delays, numOutputs);
 
-	auto maxActiveChannels = std::max(numInputChannels, numOutputChannels);
+	auto spread = jlimit(0.0f, 1.0f, m_parameters.inputSpreads[inputIdx]);
+	if (spread > 0.0f)
+		computeSpreadGains(inputPosition, spread, gains, numOutputs);
+	else
+		computeSourceGains(inputPosition, gains, numOutputs);
 
-	// copy incoming data to processing data buffer
-	for (auto i = 0; i < numInputChannels && i < maxActiveChannels; i++)
+	// part of a spread input is sent through the decorrelation filters instead. The split keeps the power, the sign
+	// alternating over the reached speakers keeps neighbouring speakers from summing the decorrelated part back up.
+	auto decorrelatedGains = m_parameters.getInputToOutputDecorrelatedGains(inputIdx);
+	FloatVectorOperations::clear(decorrelatedGains, numOutputs);
+	if (m_parameters.spreadDecorrelationEnabled && spread > 0.0f)
 	{
-		memcpy(m_processorChannels[i], inputChannelData[i], (size_t)numSamples * sizeof(float));
+		auto splitAngle = spread * MathConstants<float>::halfPi * 0.5f;
+		auto directFactor = std::cos(splitAngle);
+		auto decorrelatedFactor = std::sin(splitAngle);
+		auto sign = 1.0f;
+		for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+		{
+			if (gains[outputIdx] <= 0.0f)
+				continue;
+
+			decorrelatedGains[outputIdx] = sign * decorrelatedFactor * gains[outputIdx];
+			gains[outputIdx] *= directFactor;
+			sign = -sign;
+		}
 	}
 
-	// from juce doxygen: buffer must be the size of max(inCh, outCh) and feeds the input data into the method and is returned with output data
-	AudioBuffer<float> audioBufferToProcess(m_processorChannels, maxActiveChannels, numSamples);
-	MidiBuffer midiBufferToProcess;
-	processBlock(audioBufferToProcess, midiBufferToProcess);
+	// propagation time from the source position to the speaker position
+	FloatVectorOperations::multiply(delays, s_fieldSizeMeters / s_speedOfSound, numOutputs);
 
-	// copy the processed data buffer data to outgoing data
-	auto processedChannelCount = audioBufferToProcess.getNumChannels();
-	auto processedSampleCount = audioBufferToProcess.getNumSamples();
-	auto processedData = audioBufferToProcess.getArrayOfReadPointers();
-	jassert(processedSampleCount == numSamples);
-	for (auto i = 0; i < numOutputChannels && i < processedChannelCount; i++)
-	{
-		memcpy(outputChannelData[i], processedData[i], (size_t)processedSampleCount * sizeof(float));
-	}
+	m_parameters.markMatrixRowChanged(inputIdx);
+}
 
+void SurroundFieldMixerProcessor::computeSourceGains(const juce::Point<float>& position, float* gains, int numGains)
+{
+	// with the grid switched on and built for the current layout and panning law, the gains are a constant time table read
+	if (m_gainFieldGrid)
+		m_gainFieldGrid->lookupGains(position, gains, numGains);
+	else
+		computePanningGains(m_panningLaw, m_speakerLayout, m_vbapPanner, position, gains, numGains);
 }
 
-void SurroundFieldMixerProcessor::audioDeviceAboutToStart(AudioIODevice* device)
+void SurroundFieldMixerProcessor::computeSpreadGains(const juce::Point<float>& position, float spread, float* gains, int numGains)
 {
-	if (device)
+	// the footprint of a spread input is the energy average of virtual sources on an arc around the field centre,
+	// at the input's distance from the centre. Full spread distributes them evenly over the whole circle.
+	if (m_spreadGainScratch.size() < static_cast<size_t>(numGains))
+		m_spreadGainScratch.resize(static_cast<size_t>(numGains));
+
+	auto centre = SpeakerLayout::s_centrePos();
+	auto direction = position - centre;
+	FloatVectorOperations::clear(gains, numGains);
+	for (auto sourceIdx = 0; sourceIdx < s_numSpreadSources; sourceIdx++)
 	{
-		prepareToPlay(device->getCurrentSampleRate(), device->getCurrentBufferSizeSamples());
+		auto angle = spread * MathConstants<float>::pi * static_cast<float>(2 * sourceIdx - (s_numSpreadSources - 1)) / static_cast<float>(s_numSpreadSources);
+		computeSourceGains(centre + direction.rotatedAboutOrigin(angle), m_spreadGainScratch.data(), numGains);
+		for (auto outputIdx = 0; outputIdx < numGains; outputIdx++)
+			gains[outputIdx] += m_spreadGainScratch[outputIdx] * m_spreadGainScratch[outputIdx];
+	}
 
-		// the following somehow returns weird incorrect counts, instead the name list count used below seems to be correct...?
-		//auto inputChannels = device->getActiveInputChannels().toInteger();
-		//auto outputChannels = device->getActiveOutputChannels().toInteger();
+	for (auto outputIdx = 0; outputIdx < numGains; outputIdx++)
+		gains[outputIdx] = std::sqrt(gains[outputIdx] / static_cast<float>(s_numSpreadSources));
+}
 
-		auto inputChannelNames = device->getInputChannelNames();
-		auto outputChannelNames = device->getOutputChannelNames();
+void SurroundFieldMixerProcessor::updateAllInputToOutputGains()
+{
+	for (auto inputIdx = 0; inputIdx < m_parameters.getInputCount(); inputIdx++)
+		updateInputToOutputGains(inputIdx);
+}
 
-		initializeInputCtrlValues(inputChannelNames.size());
-		initializeOutputCtrlValues(outputChannelNames.size());
+void SurroundFieldMixerProcessor::computePanningGains(PanningLaw panningLaw, const SpeakerLayout& speakerLayout, const VBAPPanner& vbapPanner, const juce::Point<float>& position, float* gains, int numGains)
+{
+	if (panningLaw == PanningLaw::VBAP)
+	{
+		vbapPanner.computeGains(position, gains, numGains);
+	}
+	else
+	{
+		// speakers further away than the field edge length get nothing instead of an inverted signal.
+		// Lfe speakers sit in the field centre but are not part of the panning, like with VBAP they get nothing.
+		speakerLayout.computeDistances(position, gains, numGains);
+		auto numSpeakers = speakerLayout.getNumSpeakers();
+		for (auto outputIdx = 0; outputIdx < numGains; outputIdx++)
+		{
+			auto isLFE = outputIdx < numSpeakers && speakerLayout.getSpeaker(outputIdx).isLFE;
+			gains[outputIdx] = isLFE ? 0.0f : jmax(0.0f, 1.0f - gains[outputIdx]);
+		}
 	}
 }
 
-void SurroundFieldMixerProcessor::audioDeviceStopped()
+void SurroundFieldMixerProcessor::publishParameters()
 {
-	releaseResources();
+	// m_readLock is expected to be held by the caller, it serializes the writing side only.
+	// The write buffer is one or two publishes behind, only the matrix rows changed since then are copied into it.
+	m_parameterSnapshots.getWriteBuffer().updateFrom(m_parameters);
+	m_parameterSnapshots.publish();
 }
 
-void SurroundFieldMixerProcessor::initializeInputCtrlValues(int inputCount)
+AudioDeviceManager* SurroundFieldMixerProcessor::getDeviceManager()
 {
-	auto channelCount = (inputCount > s_minInputsCount) ? inputCount : s_minInputsCount;
+	if (m_deviceManager)
+		return m_deviceManager.get();
+	else
+		return nullptr;
+}
 
-	for (auto channel = 1; channel <= channelCount; channel++)
+//==============================================================================
+const String SurroundFieldMixerProcessor::getName() const
+{
+	return m_Name;
+}
+
+void SurroundFieldMixerProcessor::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+	// all working buffers are allocated here once, the audio callback only ever resizes them within their capacity
+	// capacity follows the block size and channel count of the device, larger blocks are rendered in sub-blocks
+	m_maxSamplesPerBlock = jmax(1, maximumExpectedSamplesPerBlock);
+
+	// the analyzers must not touch their fifos anymore while the memory below them is replaced
+	if (m_inputDataAnalyzer)
+		m_inputDataAnalyzer->clearParameters();
+	if (m_outputDataAnalyzer)
+		m_outputDataAnalyzer->clearParameters();
+
+	// render workers are (re)started here, off the audio thread
+	auto renderWorkerCount = 0;
+	auto lockAudioMemory = false;
 	{
-		setInputMuteState(channel, false);
-		setInputGainValue(channel, 0.8f);
-		setInputReverbValue(channel, 0.8f);
-		setInputSpreadValue(channel, 0.8f);
-		setInputPositionValue(channel, s_defaultPos());
+		const ScopedLock sl(m_readLock);
+		renderWorkerCount = m_renderWorkerCount < 0 ? jlimit(0, s_maxRenderWorkerCount, SystemStats::getNumCpus() - 1) : m_renderWorkerCount;
+		lockAudioMemory = m_audioMemoryLockEnabled;
+	}
+
+	// delay rings cover the longest possible distance across the field plus one block
+	m_sampleRate = sampleRate;
+	m_maxDelayInSamples = std::ceil(MathConstants<float>::sqrt2 * s_fieldSizeMeters / s_speedOfSound * static_cast<float>(sampleRate));
+	m_delayLineLength = nextPowerOfTwo(static_cast<int>(m_maxDelayInSamples) + m_maxSamplesPerBlock + 2);
+	m_delayLineMask = m_delayLineLength - 1;
+	m_delayLineWritePos = 0;
+
+	// one arena for all sample memory, every channel starts on a cache line.
+	// The float render buffers are always there, the double ones only when the processor is set to double precision.
+	m_isDoublePrecisionPrepared = isUsingDoublePrecision();
+	auto numRenderJobs = renderWorkerCount + 1;
+	auto analyzerMemorySize = ProcessorDataAnalyzer::getRequiredMemorySize(sampleRate, m_maxSamplesPerBlock, m_channelCapacity);
+	auto isAudioMemoryAllocated = m_audioMemory.allocate(getRenderBuffersMemorySize<float>(numRenderJobs, false)
+		+ (m_isDoublePrecisionPrepared ? getRenderBuffersMemorySize<double>(numRenderJobs, true) : 0)
+		+ getCellStateMemorySize()
+		+ SpreadDecorrelator::getRequiredMemorySize(m_channelCapacity, m_maxSamplesPerBlock)
+		+ FeedbackDelayNetwork::getRequiredMemorySize(sampleRate)
+		+ 2 * analyzerMemorySize, lockAudioMemory);
+
+	// without working memory nothing can be rendered. Everything is left unprepared, so the callbacks output silence
+	// until the next prepareToPlay succeeds.
+	if (!isAudioMemoryAllocated)
+	{
+		jassertfalse;
+		releaseResources();
+		return;
+	}
+
+	prepareRenderBuffers<float>(numRenderJobs, false);
+	if (m_isDoublePrecisionPrepared)
+		prepareRenderBuffers<double>(numRenderJobs, true);
+	else
+		releaseRenderBuffers<double>();
+
+	// everything starts silent and fades in to the current values
+	m_inputGainRamps.resize(m_channelCapacity);
+	for (auto& ramp : m_inputGainRamps)
+	{
+		ramp.reset(sampleRate, s_gainRampTimeSeconds);
+		ramp.setCurrentAndTargetValue(0.0f);
+	}
+	prepareCellState(sampleRate);
+	m_activeCellCounts.assign(m_channelCapacity, 0);
+	m_inputSilentSampleCounts.assign(m_channelCapacity, 0);
+	m_renderedInputs.assign(m_channelCapacity, 0);
+	m_numRenderedInputs = 0;
+	m_isActiveCellListDirty = true;
+	m_isDelayPathActive = false;
+
+	// the filter state is single precision for both render paths
+	m_spreadDecorrelator.prepare(m_channelCapacity, m_maxSamplesPerBlock, m_audioMemory);
+	m_isDecorrelatedPartActive.assign(m_channelCapacity, false);
+	m_isInputDecorrelated.assign(m_channelCapacity, false);
+	m_decorrelatedInputs.assign(m_channelCapacity, 0);
+	m_numDecorrelatedInputs = 0;
+
+	// the reverb network starts out silent, it is only run once something is sent to it
+	m_reverbNetwork.prepare(sampleRate, m_audioMemory);
+	m_reverbTailLength = FeedbackDelayNetwork::getTailLengthInSamples(sampleRate);
+	m_reverbSilentSampleCount = m_reverbTailLength;
+	m_reverbSendRamps.resize(m_channelCapacity);
+	for (auto& ramp : m_reverbSendRamps)
+	{
+		ramp.reset(sampleRate, s_gainRampTimeSeconds);
+		ramp.setCurrentAndTargetValue(0.0f);
 	}
+	m_reverbReturnRamps.resize(m_channelCapacity);
+	for (auto& ramp : m_reverbReturnRamps)
+	{
+		ramp.reset(sampleRate, s_gainRampTimeSeconds);
+		ramp.setCurrentAndTargetValue(0.0f);
+	}
+	m_reverbTapStartGains.assign(FeedbackDelayNetwork::s_numLines * m_channelCapacity, 0.0f);
+	m_reverbTapEndGains.assign(FeedbackDelayNetwork::s_numLines * m_channelCapacity, 0.0f);
+
+	m_renderWorkerPool.reset();
+	if (renderWorkerCount > 0)
+		m_renderWorkerPool = std::make_unique<MatrixRenderWorkerPool>(renderWorkerCount, sampleRate, m_maxSamplesPerBlock);
+	m_renderScratches.resize(numRenderJobs);
+	for (auto& scratch : m_renderScratches)
+	{
+		scratch.startGains.assign(m_channelCapacity, 0.0f);
+		scratch.endGains.assign(m_channelCapacity, 0.0f);
+		scratch.outputIndices.assign(m_channelCapacity, 0);
+	}
+
+	if (m_inputDataAnalyzer)
+		m_inputDataAnalyzer->initializeParameters(sampleRate, m_maxSamplesPerBlock, m_channelCapacity, m_audioMemory);
+	if (m_outputDataAnalyzer)
+		m_outputDataAnalyzer->initializeParameters(sampleRate, m_maxSamplesPerBlock, m_channelCapacity, m_audioMemory);
 }
 
-void SurroundFieldMixerProcessor::initializeOutputCtrlValues(int outputCount)
+void SurroundFieldMixerProcessor::releaseResources()
 {
-	auto channelCount = (outputCount > s_minOutputsCount) ? outputCount : s_minOutputsCount;
+	m_maxSamplesPerBlock = 0;
 
-	for (auto channel = 1; channel <= channelCount; channel++)
+	if (m_inputDataAnalyzer)
+		m_inputDataAnalyzer->clearParameters();
+	if (m_outputDataAnalyzer)
+		m_outputDataAnalyzer->clearParameters();
+
+	m_renderWorkerPool.reset();
+	m_renderScratches.clear();
+
+	releaseRenderBuffers<float>();
+	releaseRenderBuffers<double>();
+	m_isDoublePrecisionPrepared = false;
+
+	m_delayLineLength = 0;
+	m_delayLineMask = 0;
+	m_delayLineWritePos = 0;
+	m_isDelayPathActive = false;
+
+	m_spreadDecorrelator.release();
+	m_reverbNetwork.release();
+	releaseCellState();
+
+	m_audioMemory.release();
+}
+
+void SurroundFieldMixerProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+	ignoreUnused(midiMessages);
+
+	ScopedNoDenormals noDenormals;
+
+	// in place processing, renderBlock takes care of moving the inputs out of the way before rendering the outputs into buffer
+	renderBlock<float>(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
+}
+
+void SurroundFieldMixerProcessor::processBlock(AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+	ignoreUnused(midiMessages);
+
+	ScopedNoDenormals noDenormals;
+
+	// the host switches to double precision before preparing, so the double render buffers are expected to be there,
+	// unless preparing failed altogether
+	if (!m_isDoublePrecisionPrepared)
 	{
-		setOutputMuteState(channel, false);
-		setOutputGainValue(channel, 1.0f);
+		jassert(m_maxSamplesPerBlock <= 0);
+		buffer.clear();
+		return;
 	}
+
+	renderBlock<double>(buffer.getArrayOfReadPointers(), buffer.getNumChannels(), buffer.getArrayOfWritePointers(), buffer.getNumChannels(), buffer.getNumSamples());
 }
 
+bool SurroundFieldMixerProcessor::supportsDoublePrecisionProcessing() const
+{
+	return true;
+}
 
-} // namespace SurroundFieldMixer
+template <>
+SurroundFieldMixerProcessor::RenderBuffers<float>& SurroundFieldMixerProcessor::getRenderBuffers<float>()
+{
+	return m_floatRenderBuffers;
+}
+
+template <>
+SurroundFieldMixerProcessor::RenderBuffers<double>& SurroundFieldMixerProcessor::getRenderBuffers<double>()
+{
+	return m_doubleRenderBuffers;
+}
+
+template <typename SampleType>
+size_t SurroundFieldMixerProcessor::getRenderBuffersMemorySize(int numJobs, bool withDeviceConversion) const
+{
+	constexpr auto floatsPerSample = sizeof(SampleType) / sizeof(float);
+	auto channelSize = AudioMemoryArena::getPaddedSize(floatsPerSample * static_cast<size_t>(m_maxSamplesPerBlock));
+	auto delayLinesSize = AudioMemoryArena::getPaddedSize(floatsPerSample * static_cast<size_t>(m_channelCapacity) * m_delayLineLength);
+	auto numConversionChannels = withDeviceConversion ? 2 * m_channelCapacity : 0;
+
+	auto numReverbChannels = 1 + FeedbackDelayNetwork::s_numLines;
+	auto numWorkerOutputChannels = (numJobs - 1) * m_channelCapacity;
+
+	return (2 * m_channelCapacity + numJobs + numReverbChannels + numConversionChannels + numWorkerOutputChannels) * channelSize + 2 * delayLinesSize;
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::prepareRenderBuffers(int numJobs, bool withDeviceConversion)
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+
+	buffers.inputScratchChannels.resize(m_channelCapacity);
+	for (auto& channel : buffers.inputScratchChannels)
+		channel = m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock);
+	buffers.inputScratchBuffer.setDataToReferTo(buffers.inputScratchChannels.data(), m_channelCapacity, m_maxSamplesPerBlock);
+	buffers.inputChannels.assign(m_channelCapacity, nullptr);
+	buffers.subBlockInputChannels.assign(m_channelCapacity, nullptr);
+	buffers.subBlockOutputChannels.assign(m_channelCapacity, nullptr);
+	buffers.decorrelatedChannels.resize(m_channelCapacity);
+	for (auto& channel : buffers.decorrelatedChannels)
+		channel = m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock);
+	buffers.reverbSendBus = m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock);
+	buffers.reverbLineChannels.resize(FeedbackDelayNetwork::s_numLines);
+	for (auto& channel : buffers.reverbLineChannels)
+		channel = m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock);
+
+	// the rings of all inputs are one contiguous piece, the line length is a power of two and keeps every ring aligned
+	buffers.delayLines = m_audioMemory.takeSamples<SampleType>(static_cast<size_t>(m_channelCapacity) * m_delayLineLength);
+	buffers.decorrelatedDelayLines = m_audioMemory.takeSamples<SampleType>(static_cast<size_t>(m_channelCapacity) * m_delayLineLength);
+
+	buffers.jobs.resize(numJobs);
+	for (auto slotIdx = 0; slotIdx < numJobs; slotIdx++)
+	{
+		auto& job = buffers.jobs[slotIdx];
+		job.outputChannels.assign(m_channelCapacity, nullptr);
+		job.delayReadBuffer = m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock);
+		job.outputScratchChannels.assign(slotIdx > 0 ? m_channelCapacity : 0, nullptr);
+		for (auto& channel : job.outputScratchChannels)
+			channel = m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock);
+	}
+
+	buffers.conversionInputChannels.clear();
+	buffers.conversionOutputChannels.clear();
+	if (withDeviceConversion)
+	{
+		for (auto i = 0; i < m_channelCapacity; i++)
+		{
+			buffers.conversionInputChannels.push_back(m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock));
+			buffers.conversionOutputChannels.push_back(m_audioMemory.takeSamples<SampleType>(m_maxSamplesPerBlock));
+		}
+	}
+
+	buffers.outputChannelData = nullptr;
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::releaseRenderBuffers()
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+
+	buffers.inputScratchBuffer = AudioBuffer<SampleType>();
+	buffers.inputScratchChannels.clear();
+	buffers.inputChannels.clear();
+	buffers.subBlockInputChannels.clear();
+	buffers.subBlockOutputChannels.clear();
+	buffers.decorrelatedChannels.clear();
+	buffers.reverbSendBus = nullptr;
+	buffers.reverbLineChannels.clear();
+	buffers.delayLines = nullptr;
+	buffers.decorrelatedDelayLines = nullptr;
+	buffers.jobs.clear();
+	buffers.conversionInputChannels.clear();
+	buffers.conversionOutputChannels.clear();
+	buffers.outputChannelData = nullptr;
+}
+
+size_t SurroundFieldMixerProcessor::getCellStateMemorySize() const
+{
+	// matrix and decorrelated cells, each with a gain and a delay ramp, plus the active output lists
+	auto numCells = static_cast<size_t>(m_inputCapacity) * m_outputCapacity;
+	return 4 * AudioMemoryArena::getSizeForObjects<SmoothedValue<float>>(numCells) + AudioMemoryArena::getSizeForObjects<int>(numCells);
+}
+
+void SurroundFieldMixerProcessor::prepareCellState(double sampleRate)
+{
+	auto numCells = static_cast<size_t>(m_inputCapacity) * m_outputCapacity;
+	m_cellGainRamps = m_audioMemory.takeObjects<SmoothedValue<float>>(numCells);
+	m_cellDelayRamps = m_audioMemory.takeObjects<SmoothedValue<float>>(numCells);
+	m_decorrelatedGainRamps = m_audioMemory.takeObjects<SmoothedValue<float>>(numCells);
+	m_decorrelatedDelayRamps = m_audioMemory.takeObjects<SmoothedValue<float>>(numCells);
+	m_activeCellOutputs = m_audioMemory.takeObjects<int>(numCells);
+
+	// all cells start settled at zero, like the input ramps
+	for (size_t cellIdx = 0; cellIdx < numCells; cellIdx++)
+	{
+		m_cellGainRamps[cellIdx].reset(sampleRate, s_gainRampTimeSeconds);
+		m_cellDelayRamps[cellIdx].reset(sampleRate, s_delayRampTimeSeconds);
+		m_decorrelatedGainRamps[cellIdx].reset(sampleRate, s_gainRampTimeSeconds);
+		m_decorrelatedDelayRamps[cellIdx].reset(sampleRate, s_delayRampTimeSeconds);
+	}
+}
+
+void SurroundFieldMixerProcessor::releaseCellState()
+{
+	m_cellGainRamps = nullptr;
+	m_cellDelayRamps = nullptr;
+	m_decorrelatedGainRamps = nullptr;
+	m_decorrelatedDelayRamps = nullptr;
+	m_activeCellOutputs = nullptr;
+}
+
+void SurroundFieldMixerProcessor::renderDeviceBlockInDoublePrecision(const float* const* inputChannelData, int numInputChannels, float* const* outputChannelData, int numOutputChannels, int numSamples)
+{
+	auto& buffers = m_doubleRenderBuffers;
+
+	// channels beyond the prepared capacity are not processed at all
+	auto numConvertedInputs = jmin(numInputChannels, static_cast<int>(buffers.conversionInputChannels.size()));
+	auto numConvertedOutputs = jmin(numOutputChannels, static_cast<int>(buffers.conversionOutputChannels.size()));
+	for (auto outputIdx = numConvertedOutputs; outputIdx < numOutputChannels; outputIdx++)
+		FloatVectorOperations::clear(outputChannelData[outputIdx], numSamples);
+
+	// the device works in single precision, samples are widened on the way in and narrowed again on the way out
+	for (auto startSample = 0; startSample < numSamples; startSample += m_maxSamplesPerBlock)
+	{
+		auto numSubBlockSamples = jmin(m_maxSamplesPerBlock, numSamples - startSample);
+
+		for (auto inputIdx = 0; inputIdx < numConvertedInputs; inputIdx++)
+		{
+			auto source = inputChannelData[inputIdx] + startSample;
+			auto destination = buffers.conversionInputChannels[inputIdx];
+			for (auto i = 0; i < numSubBlockSamples; i++)
+				destination[i] = static_cast<double>(source[i]);
+		}
+
+		renderBlock<double>(buffers.conversionInputChannels.data(), numConvertedInputs, buffers.conversionOutputChannels.data(), numConvertedOutputs, numSubBlockSamples);
+
+		for (auto outputIdx = 0; outputIdx < numConvertedOutputs; outputIdx++)
+		{
+			auto source = buffers.conversionOutputChannels[outputIdx];
+			auto destination = outputChannelData[outputIdx] + startSample;
+			for (auto i = 0; i < numSubBlockSamples; i++)
+				destination[i] = static_cast<float>(source[i]);
+		}
+	}
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::renderBlock(const SampleType* const* inputChannelData, int numInputChannels, SampleType* const* outputChannelData, int numOutputChannels, int numSamples)
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+
+	if (numSamples > m_maxSamplesPerBlock)
+	{
+		// not prepared, nothing can be rendered
+		if (m_maxSamplesPerBlock <= 0)
+		{
+			for (auto outputIdx = 0; outputIdx < numOutputChannels; outputIdx++)
+				FloatVectorOperations::clear(outputChannelData[outputIdx], numSamples);
+			return;
+		}
+
+		// channels beyond the prepared capacity are not processed at all
+		numInputChannels = jmin(numInputChannels, static_cast<int>(buffers.subBlockInputChannels.size()));
+		for (auto outputIdx = static_cast<int>(buffers.subBlockOutputChannels.size()); outputIdx < numOutputChannels; outputIdx++)
+			FloatVectorOperations::clear(outputChannelData[outputIdx], numSamples);
+		numOutputChannels = jmin(numOutputChannels, static_cast<int>(buffers.subBlockOutputChannels.size()));
+
+		// the device delivered more than it announced, render in chunks that fit the preallocated buffers
+		for (auto startSample = 0; startSample < numSamples; startSample += m_maxSamplesPerBlock)
+		{
+			for (auto inputIdx = 0; inputIdx < numInputChannels; inputIdx++)
+				buffers.subBlockInputChannels[inputIdx] = inputChannelData[inputIdx] + startSample;
+			for (auto outputIdx = 0; outputIdx < numOutputChannels; outputIdx++)
+				buffers.subBlockOutputChannels[outputIdx] = outputChannelData[outputIdx] + startSample;
+
+			renderBlock<SampleType>(buffers.subBlockInputChannels.data(), numInputChannels, buffers.subBlockOutputChannels.data(), numOutputChannels, jmin(m_maxSamplesPerBlock, numSamples - startSample));
+		}
+		return;
+	}
+
+	// pick up the most recently published control values, this never blocks on the control side
+	auto hasParameterChanges = m_parameterSnapshots.update();
+	auto const& parameters = m_parameterSnapshots.getReadBuffer();
+
+	auto inputChannels = std::min({ numInputChannels, parameters.getInputCount(), m_inputCapacity });
+	auto outputChannels = std::min({ numOutputChannels, parameters.getMatrixOutputCount(), m_outputCapacity });
+
+	jassert(inputChannels <= buffers.inputScratchBuffer.getNumChannels() && numSamples <= buffers.inputScratchBuffer.getNumSamples());
+
+	// the delay path keeps running after switching the delay off until all delays have ramped down to zero
+	auto useDelayPath = (parameters.delayEnabled || m_isDelayPathActive) && m_delayLineLength > 0;
+
+	for (auto inputIdx = 0; inputIdx < inputChannels; inputIdx++)
+	{
+		// input gain and mute changes are ramped instead of jumping to the new value
+		auto& gainRamp = m_inputGainRamps[inputIdx];
+		gainRamp.setTargetValue(parameters.inputMutes[inputIdx] ? 0.0f : parameters.inputGains[inputIdx]);
+		auto startGain = gainRamp.getCurrentValue();
+		auto endGain = gainRamp.skip(numSamples);
+
+		// unity gain inputs are read straight from the device, unless the mix reads them after the
+		// outputs have been cleared and the device hands in the same memory for inputs and outputs
+		auto inputData = inputChannelData[inputIdx];
+		auto isOverwrittenByOutputs = !useDelayPath && std::find(outputChannelData, outputChannelData + numOutputChannels, inputData) != outputChannelData + numOutputChannels;
+		if (startGain == endGain && endGain == 1.0f && !isOverwrittenByOutputs)
+		{
+			buffers.inputChannels[inputIdx] = inputData;
+		}
+		else
+		{
+			if (startGain != endGain)
+			{
+				buffers.inputScratchBuffer.copyFrom(inputIdx, 0, inputData, numSamples);
+				buffers.inputScratchBuffer.applyGainRamp(inputIdx, 0, numSamples, startGain, endGain);
+			}
+			else if (endGain == 0.0f)
+				buffers.inputScratchBuffer.clear(inputIdx, 0, numSamples);
+			else
+				buffers.inputScratchBuffer.copyFrom(inputIdx, 0, inputData, numSamples, endGain);
+
+			buffers.inputChannels[inputIdx] = buffers.inputScratchBuffer.getReadPointer(inputIdx);
+		}
+
+		// many inputs are idle most of the time, those are detected here to skip them in the mix
+		auto isSilent = (startGain == 0.0f && endGain == 0.0f);
+		if (!isSilent)
+		{
+			auto range = FloatVectorOperations::findMinAndMax(buffers.inputChannels[inputIdx], numSamples);
+			isSilent = jmax(-range.getStart(), range.getEnd()) < s_silenceThreshold;
+		}
+		m_inputSilentSampleCounts[inputIdx] = isSilent ? jmin(m_inputSilentSampleCounts[inputIdx] + numSamples, std::numeric_limits<int>::max() / 2) : 0;
+	}
+
+	if (m_inputDataAnalyzer)
+		m_inputDataAnalyzer->pushAudioBuffer(buffers.inputChannels.data(), inputChannels, numSamples);
+
+	// the delay lines are always fed, so switching the delay on has history to read from
+	writeDelayLines<SampleType>(buffers.inputChannels.data(), inputChannels, numSamples);
+
+	// spread inputs are filtered before the outputs are cleared, the device may hand in the same memory for both
+	auto numDecorrelatedInputs = decorrelateInputs<SampleType>(parameters, inputChannels, numSamples);
+	auto isReverbActive = sendInputsToReverb<SampleType>(parameters, inputChannels, numSamples);
+
+	if (hasParameterChanges || m_isActiveCellListDirty || inputChannels != m_activeCellInputCount || outputChannels != m_activeCellOutputCount)
+		rebuildActiveCells(parameters, inputChannels, outputChannels);
+
+	// an input that went silent still has to be rendered until its delayed tail has left the delay lines
+	auto silentSamplesToSkip = numSamples + (useDelayPath ? static_cast<int>(m_maxDelayInSamples) + 1 : 0);
+
+	m_numRenderedInputs = 0;
+	auto numActiveCells = 0;
+	for (auto inputIdx = 0; inputIdx < inputChannels; inputIdx++)
+	{
+		if (m_activeCellCounts[inputIdx] == 0 || m_inputSilentSampleCounts[inputIdx] >= silentSamplesToSkip)
+			continue;
+
+		m_renderedInputs[m_numRenderedInputs++] = inputIdx;
+		numActiveCells += m_activeCellCounts[inputIdx];
+	}
+
+	for (auto outputIdx = 0; outputIdx < numOutputChannels; outputIdx++)
+		FloatVectorOperations::clear(outputChannelData[outputIdx], numSamples);
+
+	buffers.outputChannelData = outputChannelData;
+	m_renderContext.parameters = &parameters;
+	m_renderContext.numOutputs = outputChannels;
+	m_renderContext.numSamples = numSamples;
+	m_renderContext.useDelayPath = useDelayPath;
+	// the single pass layout kernels mix every output of an input, that only pays off while most cells are active.
+	// Sparse panning laws like VBAP leave two cells per input active and are cheaper on the gathered path.
+	// They are only used for the fixed layout that was selected, and only while the device provides all of its outputs.
+	m_renderContext.useLayoutPath = !useDelayPath
+		&& getOutputLayoutOutputCount(parameters.outputLayout) == outputChannels
+		&& numActiveCells * 2 >= m_numRenderedInputs * outputChannels;
+
+	// tiny blocks or few active cells are not worth the dispatch overhead and are rendered single threaded
+	auto numJobs = jmin(static_cast<int>(m_renderScratches.size()), static_cast<int>(buffers.jobs.size()));
+	auto isParallelRender = m_renderWorkerPool && numSamples >= s_minSamplesForParallelRender && numActiveCells >= s_minActiveCellsForParallelRender;
+	if (isParallelRender && numJobs > 1)
+	{
+		// the reverb network carries its state from block to block and cannot be rendered twice, so it is the audio thread's
+		// inline work while the workers start on the output ranges
+		m_renderContext.numJobs = jmin(numJobs, m_renderWorkerPool->getNumSlots());
+		m_renderWorkerPool->runJobs(&SurroundFieldMixerProcessor::renderJob<SampleType>, this, m_renderContext.numJobs, isReverbActive ? &SurroundFieldMixerProcessor::renderReverbJob<SampleType> : nullptr);
+
+		// the output ranges rendered by the workers are still in their slots
+		for (auto jobIdx = 0; jobIdx < m_renderContext.numJobs; jobIdx++)
+		{
+			auto slotIdx = m_renderWorkerPool->getJobSlot(jobIdx);
+			if (slotIdx == 0)
+				continue;
+
+			auto outputRange = getJobOutputRange(jobIdx);
+			for (auto outputIdx = outputRange.getStart(); outputIdx < outputRange.getEnd(); outputIdx++)
+				FloatVectorOperations::copy(outputChannelData[outputIdx], buffers.jobs[slotIdx].outputScratchChannels[outputIdx], numSamples);
+		}
+	}
+	else
+	{
+		m_renderContext.numJobs = jmin(numJobs, 1);
+		if (m_renderContext.numJobs > 0)
+			renderJob<SampleType>(this, 0, 0);
+		if (isReverbActive)
+			renderReverbNetwork<SampleType>();
+	}
+
+	advanceCellRamps(parameters, numSamples);
+
+	// the decorrelated part reads its rings at the current write position and may keep the delay path active as well
+	if (numDecorrelatedInputs > 0)
+		mixDecorrelatedInputs<SampleType>(parameters, outputChannels, numSamples);
+	if (isReverbActive)
+		mixReverbReturn<SampleType>(parameters, outputChannels, numSamples);
+
+	m_delayLineWritePos = (m_delayLineWritePos + numSamples) & m_delayLineMask;
+
+	if (m_outputDataAnalyzer)
+		m_outputDataAnalyzer->pushAudioBuffer(outputChannelData, numOutputChannels, numSamples);
+}
+
+template <typename SampleType>
+int SurroundFieldMixerProcessor::decorrelateInputs(const ProcessorParameterSnapshot& parameters, int numInputs, int numSamples)
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+	m_numDecorrelatedInputs = 0;
+	if (buffers.decorrelatedChannels.empty())
+		return 0;
+
+	// only inputs with a decorrelated part are filtered. The part keeps being rendered after the spread is gone, until it has
+	// ramped down, and inputs that have been silent for longer than the filter tail plus the longest delay are left out.
+	auto silentSamplesToSkip = numSamples + SpreadDecorrelator::s_tailLength + static_cast<int>(m_maxDelayInSamples) + 1;
+	for (auto inputIdx = 0; inputIdx < numInputs; inputIdx++)
+	{
+		auto isDecorrelated = parameters.spreadDecorrelationEnabled && parameters.inputSpreads[inputIdx] > 0.0f;
+		auto isFiltered = (isDecorrelated || m_isDecorrelatedPartActive[inputIdx]) && m_inputSilentSampleCounts[inputIdx] < silentSamplesToSkip;
+
+		// an input that joins starts from silence, not from the filter state and ring contents it was left with
+		if (isFiltered && !m_isInputDecorrelated[inputIdx])
+		{
+			m_spreadDecorrelator.reset(inputIdx);
+			if (buffers.decorrelatedDelayLines != nullptr)
+				FloatVectorOperations::clear(buffers.decorrelatedDelayLines + static_cast<size_t>(inputIdx) * m_delayLineLength, m_delayLineLength);
+		}
+
+		m_isInputDecorrelated[inputIdx] = isFiltered;
+		if (isFiltered)
+			m_decorrelatedInputs[m_numDecorrelatedInputs++] = inputIdx;
+	}
+	for (auto inputIdx = numInputs; inputIdx < static_cast<int>(m_isInputDecorrelated.size()); inputIdx++)
+		m_isInputDecorrelated[inputIdx] = false;
+
+	if (m_numDecorrelatedInputs == 0)
+		return 0;
+
+	m_spreadDecorrelator.process(buffers.inputChannels.data(), buffers.decorrelatedChannels.data(), m_decorrelatedInputs.data(), m_numDecorrelatedInputs, numSamples);
+
+	// the all-pass chain is time invariant, so delaying its output is the same as filtering the delayed input
+	if (buffers.decorrelatedDelayLines != nullptr)
+	{
+		for (auto i = 0; i < m_numDecorrelatedInputs; i++)
+		{
+			auto inputIdx = m_decorrelatedInputs[i];
+			writeDelayLine<SampleType>(buffers.decorrelatedDelayLines + static_cast<size_t>(inputIdx) * m_delayLineLength, buffers.decorrelatedChannels[inputIdx], numSamples);
+		}
+	}
+
+	return m_numDecorrelatedInputs;
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::mixDecorrelatedInputs(const ProcessorParameterSnapshot& parameters, int numOutputs, int numSamples)
+{
+	// runs on the audio thread after the render jobs, slot 0 is the audio thread's own and free to use here
+	auto& buffers = getRenderBuffers<SampleType>();
+	auto& scratch = m_renderScratches[0];
+	auto& jobBuffers = buffers.jobs[0];
+	auto useDelayPath = m_renderContext.useDelayPath && buffers.decorrelatedDelayLines != nullptr;
+
+	for (auto i = 0; i < m_numDecorrelatedInputs; i++)
+	{
+		auto inputIdx = m_decorrelatedInputs[i];
+		auto isDecorrelated = parameters.spreadDecorrelationEnabled && parameters.inputSpreads[inputIdx] > 0.0f;
+
+		// ramped like the matrix cells, with output gain and mute folded in. The gains carry a sign, so only exact zeros are skipped.
+		auto decorrelatedGains = parameters.getInputToOutputDecorrelatedGains(inputIdx);
+		auto gainRamps = m_decorrelatedGainRamps + inputIdx * m_outputCapacity;
+		auto delayRamps = m_decorrelatedDelayRamps + inputIdx * m_outputCapacity;
+		auto numActiveOutputs = 0;
+		auto isActive = false;
+		auto isRamping = false;
+		for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+		{
+			auto outputGain = (outputIdx >= parameters.getOutputCount() || parameters.outputMutes[outputIdx]) ? 0.0f : parameters.outputGains[outputIdx];
+			auto targetGain = isDecorrelated ? decorrelatedGains[outputIdx] * outputGain : 0.0f;
+			if (std::abs(targetGain) < s_minCellGain)
+				targetGain = 0.0f;
+
+			auto& gainRamp = gainRamps[outputIdx];
+			gainRamp.setTargetValue(targetGain);
+			if (targetGain == 0.0f && gainRamp.getCurrentValue() == 0.0f)
+			{
+				delayRamps[outputIdx].setCurrentAndTargetValue(getCellDelayInSamples(parameters, inputIdx, outputIdx)); // inaudible, no need to glide
+				continue;
+			}
+
+			scratch.startGains[numActiveOutputs] = gainRamp.getCurrentValue();
+			scratch.endGains[numActiveOutputs] = gainRamp.skip(numSamples);
+			scratch.outputIndices[numActiveOutputs] = outputIdx;
+			jobBuffers.outputChannels[numActiveOutputs] = buffers.outputChannelData[outputIdx];
+			isActive = isActive || scratch.endGains[numActiveOutputs] != 0.0f;
+			isRamping = isRamping || scratch.startGains[numActiveOutputs] != scratch.endGains[numActiveOutputs];
+			numActiveOutputs++;
+		}
+		m_isDecorrelatedPartActive[inputIdx] = isActive;
+
+		if (numActiveOutputs == 0)
+			continue;
+
+		if (useDelayPath)
+			mixDelayedInputToOutputs<SampleType>(buffers.decorrelatedDelayLines + static_cast<size_t>(inputIdx) * m_delayLineLength, delayRamps, inputIdx, scratch.outputIndices.data(), numActiveOutputs, scratch, jobBuffers);
+		else if (isRamping)
+			m_mixKernel.mixInputToOutputsRamped(buffers.decorrelatedChannels[inputIdx], jobBuffers.outputChannels.data(), scratch.startGains.data(), scratch.endGains.data(), numActiveOutputs, numSamples);
+		else
+			m_mixKernel.mixInputToOutputs(buffers.decorrelatedChannels[inputIdx], jobBuffers.outputChannels.data(), scratch.endGains.data(), numActiveOutputs, numSamples);
+	}
+}
+
+template <typename SampleType>
+bool SurroundFieldMixerProcessor::sendInputsToReverb(const ProcessorParameterSnapshot& parameters, int numInputs, int numSamples)
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+	if (buffers.reverbSendBus == nullptr)
+		return false;
+
+	// all sends are summed into one bus first, so the network runs once no matter how many inputs are sent to it
+	FloatVectorOperations::clear(buffers.reverbSendBus, numSamples);
+	auto isAnyInputSent = false;
+	for (auto inputIdx = 0; inputIdx < numInputs; inputIdx++)
+	{
+		auto& sendRamp = m_reverbSendRamps[inputIdx];
+		sendRamp.setTargetValue(parameters.reverbEnabled ? parameters.inputReverbs[inputIdx] : 0.0f);
+		auto startGain = sendRamp.getCurrentValue();
+		auto endGain = sendRamp.skip(numSamples);
+		if ((startGain == 0.0f && endGain == 0.0f) || m_inputSilentSampleCounts[inputIdx] >= numSamples)
+			continue;
+
+		if (startGain != endGain)
+			m_mixKernel.mixInputToOutputsRamped(buffers.inputChannels[inputIdx], &buffers.reverbSendBus, &startGain, &endGain, 1, numSamples);
+		else
+			m_mixKernel.mixInputToOutputs(buffers.inputChannels[inputIdx], &buffers.reverbSendBus, &endGain, 1, numSamples);
+		isAnyInputSent = true;
+	}
+
+	// the network keeps running after the last send until its tail has decayed
+	m_reverbSilentSampleCount = isAnyInputSent ? 0 : jmin(m_reverbSilentSampleCount + numSamples, std::numeric_limits<int>::max() / 2);
+	return m_reverbSilentSampleCount < m_reverbTailLength;
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::renderReverbNetwork()
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+	m_reverbNetwork.process(buffers.reverbSendBus, buffers.reverbLineChannels.data(), m_renderContext.numSamples);
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::mixReverbReturn(const ProcessorParameterSnapshot& parameters, int numOutputs, int numSamples)
+{
+	// runs on the audio thread after the render jobs, so slot 0's output channel list is free to use
+	auto& buffers = getRenderBuffers<SampleType>();
+	auto& jobBuffers = buffers.jobs[0];
+
+	// output gain and mute are folded into the return ramps, like into the matrix cells.
+	// Every line is then mixed into all reached outputs with its tap gains in one kernel pass.
+	auto numReturnOutputs = 0;
+	auto isRamping = false;
+	for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+	{
+		auto outputGain = (outputIdx >= parameters.getOutputCount() || parameters.outputMutes[outputIdx]) ? 0.0f : parameters.outputGains[outputIdx];
+		auto& returnRamp = m_reverbReturnRamps[outputIdx];
+		returnRamp.setTargetValue(parameters.reverbOutputGains[outputIdx] * outputGain);
+		auto startGain = returnRamp.getCurrentValue();
+		auto endGain = returnRamp.skip(numSamples);
+		if (startGain == 0.0f && endGain == 0.0f)
+			continue;
+
+		for (auto lineIdx = 0; lineIdx < FeedbackDelayNetwork::s_numLines; lineIdx++)
+		{
+			auto tapGain = FeedbackDelayNetwork::getOutputTapGain(outputIdx, lineIdx);
+			m_reverbTapStartGains[lineIdx * m_channelCapacity + numReturnOutputs] = tapGain * startGain;
+			m_reverbTapEndGains[lineIdx * m_channelCapacity + numReturnOutputs] = tapGain * endGain;
+		}
+		jobBuffers.outputChannels[numReturnOutputs] = buffers.outputChannelData[outputIdx];
+		isRamping = isRamping || startGain != endGain;
+		numReturnOutputs++;
+	}
+
+	if (numReturnOutputs == 0)
+		return;
+
+	for (auto lineIdx = 0; lineIdx < FeedbackDelayNetwork::s_numLines; lineIdx++)
+	{
+		auto startGains = m_reverbTapStartGains.data() + lineIdx * m_channelCapacity;
+		auto endGains = m_reverbTapEndGains.data() + lineIdx * m_channelCapacity;
+		if (isRamping)
+			m_mixKernel.mixInputToOutputsRamped(buffers.reverbLineChannels[lineIdx], jobBuffers.outputChannels.data(), startGains, endGains, numReturnOutputs, numSamples);
+		else
+			m_mixKernel.mixInputToOutputs(buffers.reverbLineChannels[lineIdx], jobBuffers.outputChannels.data(), endGains, numReturnOutputs, numSamples);
+	}
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::writeDelayLines(const SampleType* const* inputChannelData, int numInputs, int numSamples)
+{
+	auto delayLines = getRenderBuffers<SampleType>().delayLines;
+	if (m_delayLineLength == 0 || delayLines == nullptr)
+		return;
+
+	for (auto inputIdx = 0; inputIdx < numInputs; inputIdx++)
+		writeDelayLine<SampleType>(delayLines + static_cast<size_t>(inputIdx) * m_delayLineLength, inputChannelData[inputIdx], numSamples);
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::writeDelayLine(SampleType* delayLine, const SampleType* data, int numSamples)
+{
+	auto firstPartLength = jmin(numSamples, m_delayLineLength - m_delayLineWritePos);
+	FloatVectorOperations::copy(delayLine + m_delayLineWritePos, data, firstPartLength);
+	FloatVectorOperations::copy(delayLine, data + firstPartLength, numSamples - firstPartLength);
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::readDelayLine(const SampleType* delayLine, float delayInSamples, int numSamples, SampleType* destination)
+{
+	// y[n] = (1 - f) * x[n - d] + f * x[n - d - 1], done as two vectorized passes over the ring
+	auto integerDelay = static_cast<int>(delayInSamples);
+	auto fraction = static_cast<SampleType>(delayInSamples - static_cast<float>(integerDelay));
+
+	auto readPos = (m_delayLineWritePos - integerDelay) & m_delayLineMask;
+	auto firstPartLength = jmin(numSamples, m_delayLineLength - readPos);
+	FloatVectorOperations::copyWithMultiply(destination, delayLine + readPos, 1 - fraction, firstPartLength);
+	FloatVectorOperations::copyWithMultiply(destination + firstPartLength, delayLine, 1 - fraction, numSamples - firstPartLength);
+
+	if (fraction > 0)
+	{
+		readPos = (readPos - 1) & m_delayLineMask;
+		firstPartLength = jmin(numSamples, m_delayLineLength - readPos);
+		FloatVectorOperations::addWithMultiply(destination, delayLine + readPos, fraction, firstPartLength);
+		FloatVectorOperations::addWithMultiply(destination + firstPartLength, delayLine, fraction, numSamples - firstPartLength);
+	}
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::readDelayLineRamped(const SampleType* delayLine, float startDelayInSamples, float endDelayInSamples, int numSamples, SampleType* destination)
+{
+	// delay moves linearly over the block, every sample is interpolated individually
+	auto delayIncrement = (static_cast<SampleType>(endDelayInSamples) - startDelayInSamples) / static_cast<SampleType>(numSamples);
+	auto delayInSamples = static_cast<SampleType>(startDelayInSamples);
+	for (auto i = 0; i < numSamples; i++)
+	{
+		auto readPos = static_cast<SampleType>(m_delayLineWritePos + i) - delayInSamples;
+		auto integerReadPos = static_cast<int>(std::floor(readPos));
+		auto fraction = readPos - static_cast<SampleType>(integerReadPos);
+		auto a = delayLine[integerReadPos & m_delayLineMask];
+		auto b = delayLine[(integerReadPos + 1) & m_delayLineMask];
+		destination[i] = a + fraction * (b - a);
+		delayInSamples += delayIncrement;
+	}
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::mixDelayedInputToOutputs(const SampleType* delayLine, const SmoothedValue<float>* delayRamps, int inputIdx, const int* activeOutputs, int numActiveOutputs, RenderScratch& scratch, RenderJobBuffers<SampleType>& jobBuffers)
+{
+	// every cell reads its input at its own delay, so cells are mixed one by one instead of in output groups.
+	// The gains and output channels of the given cells for this block are expected in the scratch, in the order of activeOutputs.
+	auto& parameters = *m_renderContext.parameters;
+	auto numSamples = m_renderContext.numSamples;
+	auto delayReadBuffer = jobBuffers.delayReadBuffer;
+
+	for (auto i = 0; i < numActiveOutputs; i++)
+	{
+		auto outputIdx = activeOutputs[i];
+		auto delayRamp = delayRamps[outputIdx];
+		delayRamp.setTargetValue(getCellDelayInSamples(parameters, inputIdx, outputIdx));
+		auto startDelay = delayRamp.getCurrentValue();
+		auto endDelay = delayRamp.skip(numSamples);
+
+		auto startGain = scratch.startGains[i];
+		auto endGain = scratch.endGains[i];
+		if (startGain == 0.0f && endGain == 0.0f)
+			continue;
+
+		if (startDelay == endDelay)
+			readDelayLine<SampleType>(delayLine, endDelay, numSamples, delayReadBuffer);
+		else
+			readDelayLineRamped<SampleType>(delayLine, startDelay, endDelay, numSamples, delayReadBuffer);
+
+		if (startGain == endGain)
+			m_mixKernel.mixInputToOutputs(delayReadBuffer, &jobBuffers.outputChannels[i], &scratch.endGains[i], 1, numSamples);
+		else
+			m_mixKernel.mixInputToOutputsRamped(delayReadBuffer, &jobBuffers.outputChannels[i], &scratch.startGains[i], &scratch.endGains[i], 1, numSamples);
+	}
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::renderJob(void* context, int jobIdx, int slotIdx)
+{
+	auto processor = static_cast<SurroundFieldMixerProcessor*>(context);
+	auto outputRange = processor->getJobOutputRange(jobIdx);
+
+	processor->renderOutputRange<SampleType>(outputRange.getStart(), outputRange.getEnd(), slotIdx);
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::renderReverbJob(void* context)
+{
+	static_cast<SurroundFieldMixerProcessor*>(context)->renderReverbNetwork<SampleType>();
+}
+
+Range<int> SurroundFieldMixerProcessor::getJobOutputRange(int jobIdx) const
+{
+	// jobs cover whole mix kernel output groups, so no group is split between two jobs
+	auto numOutputs = m_renderContext.numOutputs;
+	auto numJobs = jmax(1, m_renderContext.numJobs);
+	auto numGroups = (numOutputs + MatrixMixKernel::s_outputsPerPass - 1) / MatrixMixKernel::s_outputsPerPass;
+	auto outputBegin = jmin(numOutputs, (numGroups * jobIdx / numJobs) * MatrixMixKernel::s_outputsPerPass);
+	auto outputEnd = jmin(numOutputs, (numGroups * (jobIdx + 1) / numJobs) * MatrixMixKernel::s_outputsPerPass);
+
+	return { outputBegin, outputEnd };
+}
+
+template <typename SampleType, OutputLayout Layout>
+void SurroundFieldMixerProcessor::renderLayoutOutputs(SampleType* const* outputChannelData)
+{
+	constexpr auto numOutputs = OutputLayoutTraits<Layout>::s_numOutputs;
+	auto& buffers = getRenderBuffers<SampleType>();
+	auto numSamples = m_renderContext.numSamples;
+
+	float startGains[numOutputs];
+	float endGains[numOutputs];
+
+	for (auto renderedInputIdx = 0; renderedInputIdx < m_numRenderedInputs; renderedInputIdx++)
+	{
+		auto inputIdx = m_renderedInputs[renderedInputIdx];
+
+		// inactive cells are settled at zero and simply mixed with zero gain
+		auto cellGainRamps = m_cellGainRamps + inputIdx * m_outputCapacity;
+		auto isRamping = false;
+		for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+		{
+			auto gainRamp = cellGainRamps[outputIdx];
+			startGains[outputIdx] = gainRamp.getCurrentValue();
+			endGains[outputIdx] = gainRamp.skip(numSamples);
+			isRamping = isRamping || startGains[outputIdx] != endGains[outputIdx];
+		}
+
+		if (isRamping)
+			m_mixKernel.mixInputToLayoutOutputsRamped(buffers.inputChannels[inputIdx], outputChannelData, startGains, endGains, numOutputs, numSamples);
+		else
+			m_mixKernel.mixInputToLayoutOutputs(buffers.inputChannels[inputIdx], outputChannelData, endGains, numOutputs, numSamples);
+	}
+}
+
+template <typename SampleType>
+void SurroundFieldMixerProcessor::renderOutputRange(int outputBegin, int outputEnd, int slotIdx)
+{
+	auto& buffers = getRenderBuffers<SampleType>();
+	auto& scratch = m_renderScratches[slotIdx];
+	auto& jobBuffers = buffers.jobs[slotIdx];
+	auto numSamples = m_renderContext.numSamples;
+
+	if (outputBegin >= outputEnd)
+		return;
+
+	// the audio thread renders into the device outputs, which are cleared already. Workers render into their own slot.
+	auto outputChannelData = buffers.outputChannelData;
+	if (slotIdx > 0)
+	{
+		outputChannelData = jobBuffers.outputScratchChannels.data();
+		for (auto outputIdx = outputBegin; outputIdx < outputEnd; outputIdx++)
+			FloatVectorOperations::clear(outputChannelData[outputIdx], numSamples);
+	}
+
+	// the fixed speaker layouts render all outputs of an input in one unrolled pass, without gathering the active cells first.
+	// Delayed cells each read their own delay line position, those always take the per cell path below.
+	if (m_renderContext.useLayoutPath && outputBegin == 0 && outputEnd == m_renderContext.numOutputs)
+	{
+		switch (m_renderContext.parameters->outputLayout)
+		{
+		case OutputLayout::Surround50:
+			renderLayoutOutputs<SampleType, OutputLayout::Surround50>(outputChannelData);
+			return;
+		case OutputLayout::Surround51:
+			renderLayoutOutputs<SampleType, OutputLayout::Surround51>(outputChannelData);
+			return;
+		case OutputLayout::Surround71:
+			renderLayoutOutputs<SampleType, OutputLayout::Surround71>(outputChannelData);
+			return;
+		case OutputLayout::Surround714:
+			renderLayoutOutputs<SampleType, OutputLayout::Surround714>(outputChannelData);
+			return;
+		case OutputLayout::Generic:
+		default:
+			break;
+		}
+	}
+
+	for (auto renderedInputIdx = 0; renderedInputIdx < m_numRenderedInputs; renderedInputIdx++)
+	{
+		auto inputIdx = m_renderedInputs[renderedInputIdx];
+
+		// active outputs are sorted ascending, only the part within this job's output range is rendered here
+		auto activeOutputs = m_activeCellOutputs + inputIdx * m_outputCapacity;
+		auto numActiveOutputs = m_activeCellCounts[inputIdx];
+		auto first = 0;
+		while (first < numActiveOutputs && activeOutputs[first] < outputBegin)
+			first++;
+		auto last = first;
+		while (last < numActiveOutputs && activeOutputs[last] < outputEnd)
+			last++;
+		if (first == last)
+			continue;
+
+		activeOutputs += first;
+		numActiveOutputs = last - first;
+
+		// output gain and mute are folded into the per cell ramps, so they are applied within the mix pass.
+		// Gains and output channels of the active cells are gathered, so the kernel can still work on output groups.
+		auto cellGainRamps = m_cellGainRamps + inputIdx * m_outputCapacity;
+		auto isRamping = false;
+		for (auto i = 0; i < numActiveOutputs; i++)
+		{
+			auto outputIdx = activeOutputs[i];
+			auto gainRamp = cellGainRamps[outputIdx];
+			scratch.startGains[i] = gainRamp.getCurrentValue();
+			scratch.endGains[i] = gainRamp.skip(numSamples);
+			jobBuffers.outputChannels[i] = outputChannelData[outputIdx];
+			isRamping = isRamping || scratch.startGains[i] != scratch.endGains[i];
+		}
+
+		if (m_renderContext.useDelayPath)
+			mixDelayedInputToOutputs<SampleType>(buffers.delayLines + static_cast<size_t>(inputIdx) * m_delayLineLength, m_cellDelayRamps + inputIdx * m_outputCapacity, inputIdx, activeOutputs, numActiveOutputs, scratch, jobBuffers);
+		else if (isRamping)
+			m_mixKernel.mixInputToOutputsRamped(buffers.inputChannels[inputIdx], jobBuffers.outputChannels.data(), scratch.startGains.data(), scratch.endGains.data(), numActiveOutputs, numSamples);
+		else
+			m_mixKernel.mixInputToOutputs(buffers.inputChannels[inputIdx], jobBuffers.outputChannels.data(), scratch.endGains.data(), numActiveOutputs, numSamples);
+	}
+}
+
+void SurroundFieldMixerProcessor::advanceCellRamps(const ProcessorParameterSnapshot& parameters, int numSamples)
+{
+	// the render jobs work on copies of the cell ramps, the ramps themselves are moved on by the block here, once all jobs are done
+	auto isAnyRamping = false;
+	auto isAnyDelayActive = false;
+	for (auto renderedInputIdx = 0; renderedInputIdx < m_numRenderedInputs; renderedInputIdx++)
+	{
+		auto inputIdx = m_renderedInputs[renderedInputIdx];
+		auto activeOutputs = m_activeCellOutputs + inputIdx * m_outputCapacity;
+		auto numActiveOutputs = m_activeCellCounts[inputIdx];
+		auto cellGainRamps = m_cellGainRamps + inputIdx * m_outputCapacity;
+		auto cellDelayRamps = m_cellDelayRamps + inputIdx * m_outputCapacity;
+
+		for (auto i = 0; i < numActiveOutputs; i++)
+		{
+			auto outputIdx = activeOutputs[i];
+
+			// cells that have finished ramping down are dropped from the list with the next rebuild
+			auto& gainRamp = cellGainRamps[outputIdx];
+			isAnyRamping = isAnyRamping || gainRamp.isSmoothing();
+			gainRamp.skip(numSamples);
+
+			if (m_renderContext.useDelayPath)
+			{
+				auto& delayRamp = cellDelayRamps[outputIdx];
+				delayRamp.setTargetValue(getCellDelayInSamples(parameters, inputIdx, outputIdx));
+				auto startDelay = delayRamp.getCurrentValue();
+				auto endDelay = delayRamp.skip(numSamples);
+				isAnyDelayActive = isAnyDelayActive || startDelay > 0.0f || endDelay > 0.0f;
+			}
+		}
+	}
+
+	m_isActiveCellListDirty = m_isActiveCellListDirty || isAnyRamping;
+	m_isDelayPathActive = isAnyDelayActive;
+}
+
+float SurroundFieldMixerProcessor::getCellDelayInSamples(const ProcessorParameterSnapshot& parameters, int inputIdx, int outputIdx) const
+{
+	if (!parameters.delayEnabled)
+		return 0.0f;
+
+	return jlimit(0.0f, m_maxDelayInSamples, parameters.getInputToOutputDelays(inputIdx)[outputIdx] * static_cast<float>(m_sampleRate));
+}
+
+void SurroundFieldMixerProcessor::rebuildActiveCells(const ProcessorParameterSnapshot& parameters, int numInputs, int numOutputs)
+{
+	m_activeCellInputCount = numInputs;
+	m_activeCellOutputCount = numOutputs;
+	m_isActiveCellListDirty = false;
+
+	for (auto inputIdx = 0; inputIdx < numInputs; inputIdx++)
+	{
+		auto cellGains = parameters.getInputToOutputGains(inputIdx);
+		auto cellGainRamps = m_cellGainRamps + inputIdx * m_outputCapacity;
+		auto cellDelayRamps = m_cellDelayRamps + inputIdx * m_outputCapacity;
+		auto activeOutputs = m_activeCellOutputs + inputIdx * m_outputCapacity;
+		auto numActiveOutputs = 0;
+
+		for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+		{
+			auto outputGain = (outputIdx >= parameters.getOutputCount() || parameters.outputMutes[outputIdx]) ? 0.0f : parameters.outputGains[outputIdx];
+			auto targetGain = cellGains[outputIdx] * outputGain;
+			if (targetGain < s_minCellGain)
+				targetGain = 0.0f;
+
+			auto& gainRamp = cellGainRamps[outputIdx];
+			gainRamp.setTargetValue(targetGain);
+
+			if (targetGain > 0.0f || gainRamp.getCurrentValue() != 0.0f)
+				activeOutputs[numActiveOutputs++] = outputIdx;
+			else if (m_delayLineLength > 0)
+				cellDelayRamps[outputIdx].setCurrentAndTargetValue(getCellDelayInSamples(parameters, inputIdx, outputIdx)); // inaudible, no need to glide
+		}
+
+		m_activeCellCounts[inputIdx] = numActiveOutputs;
+	}
+}
+
+float SurroundFieldMixerProcessor::getInputToOutputGain(int input, int output)
+{
+	jassert(input > 0 && output > 0);
+	const ScopedLock sl(m_readLock);
+	if (input > m_parameters.getInputCount() || output > m_parameters.getMatrixOutputCount())
+		return 0.0f;
+
+	return m_parameters.getInputToOutputGains(input - 1)[output - 1];
+}
+
+void SurroundFieldMixerProcessor::processingDataChanged(AbstractProcessorData* data)
+{
+	if (!data || data->GetDataType() != AbstractProcessorData::Level)
+		return;
+
+	auto levelData = static_cast<ProcessorLevelData*>(data);
+	auto channelCount = levelData->GetChannelCount();
+
+	if (m_inputDataAnalyzer && levelData == &m_inputDataAnalyzer->GetLevel())
+	{
+		for (auto const& inputCommander : m_inputCommanders)
+		{
+			for (std::uint16_t i = 1; i < channelCount + 1; i++)
+				inputCommander->setInputLevel(i, levelData->GetLevel(i).GetFactorRMSdB());
+		}
+	}
+	else if (m_outputDataAnalyzer && levelData == &m_outputDataAnalyzer->GetLevel())
+	{
+		for (auto const& outputCommander : m_outputCommanders)
+		{
+			for (std::uint16_t i = 1; i < channelCount + 1; i++)
+				outputCommander->setOutputLevel(i, levelData->GetLevel(i).GetFactorRMSdB());
+		}
+	}
+}
+
+double SurroundFieldMixerProcessor::getTailLengthSeconds() const
+{
+	const ScopedLock sl(m_readLock);
+
+	// propagation delay across the field, while the distance delay is on
+	auto tailLengthSeconds = m_parameters.delayEnabled ? MathConstants<double>::sqrt2 * s_fieldSizeMeters / s_speedOfSound : 0.0;
+
+	// plus the decay of the shared reverb down to -120dB, as long as any input is sent to it
+	auto isAnyInputSentToReverb = std::any_of(m_parameters.inputReverbs.begin(), m_parameters.inputReverbs.end(), [](float send) { return send > 0.0f; });
+	if (m_parameters.reverbEnabled && isAnyInputSentToReverb)
+		tailLengthSeconds += 2.0 * FeedbackDelayNetwork::s_decayTimeSeconds;
+
+	return tailLengthSeconds;
+}
+
+bool SurroundFieldMixerProcessor::acceptsMidi() const
+{
+	return false;
+}
+
+bool SurroundFieldMixerProcessor::producesMidi() const
+{
+	return false;
+}
+
+AudioProcessorEditor* SurroundFieldMixerProcessor::createEditor()
+{
+	if (!m_processorEditor)
+		m_processorEditor = std::make_unique<SurroundFieldMixerEditor>(this);
+
+	return m_processorEditor.get();
+}
+
+bool SurroundFieldMixerProcessor::hasEditor() const
+{
+	return !!m_processorEditor;
+}
+
+int SurroundFieldMixerProcessor::getNumPrograms()
+{
+	/*dbg*/return 0;
+}
+
+int SurroundFieldMixerProcessor::getCurrentProgram()
+{
+	/*dbg*/return 0;
+}
+
+void SurroundFieldMixerProcessor::setCurrentProgram(int index)
+{
+	/*dbg*/ignoreUnused(index);
+}
+
+const String SurroundFieldMixerProcessor::getProgramName(int index)
+{
+	/*dbg*/ignoreUnused(index);
+	/*dbg*/return String();
+}
+
+void SurroundFieldMixerProcessor::changeProgramName(int index, const String& newName)
+{
+	/*dbg*/ignoreUnused(index);
+	/*dbg*/ignoreUnused(newName);
+}
+
+void SurroundFieldMixerProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+	copyXmlToBinary(*createStateXml(), destData);
+}
+
+void SurroundFieldMixerProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+	auto stateXml = getXmlFromBinary(data, sizeInBytes);
+	setStateXml(stateXml.get());
+}
+
+std::unique_ptr<XmlElement> SurroundFieldMixerProcessor::createStateXml()
+{
+	auto stateXml = std::make_unique<XmlElement>(SurroundFieldMixerProcessor::s_stateTagName);
+	stateXml->setAttribute("delayEnabled", getDelayEnabled() ? 1 : 0);
+	stateXml->setAttribute("renderWorkerCount", getRenderWorkerCount());
+	stateXml->setAttribute("doublePrecision", getDoublePrecisionEnabled() ? 1 : 0);
+	stateXml->setAttribute("panningLaw", getPanningLaw() == PanningLaw::VBAP ? "VBAP" : "Distance");
+	stateXml->setAttribute("gainFieldGrid", getGainFieldGridEnabled() ? 1 : 0);
+	stateXml->setAttribute("reverbEnabled", getReverbEnabled() ? 1 : 0);
+
+	// a loaded or custom speaker layout is stored as a whole, the fixed layouts are created again from the device channels
+	if (getOutputLayout() == OutputLayout::Generic)
+		stateXml->addChildElement(getSpeakerLayout().createStateXml().release());
+
+	return stateXml;
+}
+
+bool SurroundFieldMixerProcessor::setStateXml(XmlElement* stateXml)
+{
+	// settings missing from the xml keep their current value
+	if (!stateXml || !stateXml->hasTagName(s_stateTagName))
+		return false;
+
+	setDelayEnabled(stateXml->getBoolAttribute("delayEnabled", getDelayEnabled()));
+	setRenderWorkerCount(stateXml->getIntAttribute("renderWorkerCount", getRenderWorkerCount()));
+	setDoublePrecisionEnabled(stateXml->getBoolAttribute("doublePrecision", getDoublePrecisionEnabled()));
+	if (stateXml->hasAttribute("panningLaw"))
+		setPanningLaw(stateXml->getStringAttribute("panningLaw") == "VBAP" ? PanningLaw::VBAP : PanningLaw::Distance);
+	setGainFieldGridEnabled(stateXml->getBoolAttribute("gainFieldGrid", getGainFieldGridEnabled()));
+	setReverbEnabled(stateXml->getBoolAttribute("reverbEnabled", getReverbEnabled()));
+
+	for (auto childXml : stateXml->getChildIterator())
+	{
+		SpeakerLayout speakerLayout;
+		if (speakerLayout.setStateXml(childXml))
+			setSpeakerLayout(speakerLayout);
+	}
+
+	return true;
+}
+
+void SurroundFieldMixerProcessor::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+	float* const* outputChannelData, int numOutputChannels, int numSamples, const AudioIODeviceCallbackContext& context)
+{
+    ignoreUnused(context);
+    
+	// no locking here, control values reach the audio thread through m_parameterSnapshots
+
+	// decaying gain ramps and delay tails would otherwise run into denormals, which are very slow on x86.
+	// Sets flush to zero / denormals are zero (FZ on arm) for the duration of the callback only.
+	ScopedNoDenormals noDenormals;
+
+	// the matrix reads the device inputs and renders into the device outputs directly, the working buffers allocated in prepareToPlay are only used where needed
+	if (m_isDoublePrecisionPrepared)
+		renderDeviceBlockInDoublePrecision(inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+	else
+		renderBlock<float>(inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+}
+
+void SurroundFieldMixerProcessor::audioDeviceAboutToStart(AudioIODevice* device)
+{
+	if (device)
+	{
+		// the following somehow returns weird incorrect counts, instead the name list count used below seems to be correct...?
+		//auto inputChannels = device->getActiveInputChannels().toInteger();
+		//auto outputChannels = device->getActiveOutputChannels().toInteger();
+
+		auto inputChannelNames = device->getInputChannelNames();
+		auto outputChannelNames = device->getOutputChannelNames();
+
+		// the device is not running yet, so all buffers can be sized to what it offers here, off the audio thread
+		m_inputCapacity = jlimit(s_minInputsCount, s_maxChannelCount, inputChannelNames.size());
+		m_outputCapacity = jlimit(s_minOutputsCount, s_maxChannelCount, outputChannelNames.size());
+		m_channelCapacity = jmax(m_inputCapacity, m_outputCapacity);
+		prepareToPlay(device->getCurrentSampleRate(), device->getCurrentBufferSizeSamples());
+
+		initializeInputCtrlValues(inputChannelNames.size());
+		initializeOutputCtrlValues(outputChannelNames.size());
+	}
+}
+
+void SurroundFieldMixerProcessor::audioDeviceStopped()
+{
+	releaseResources();
+}
+
+void SurroundFieldMixerProcessor::initializeInputCtrlValues(int inputCount)
+{
+	auto channelCount = (inputCount > s_minInputsCount) ? inputCount : s_minInputsCount;
+
+	for (auto channel = 1; channel <= channelCount; channel++)
+	{
+		setInputMuteState(channel, false);
+		setInputGainValue(channel, 0.8f);
+		// inputs start dry, the reverb send is opened per input once the shared reverb is in use
+		setInputReverbValue(channel, 0.0f);
+		setInputSpreadValue(channel, 0.0f);
+		setInputPositionValue(channel, s_defaultPos());
+	}
+}
+
+void SurroundFieldMixerProcessor::initializeOutputCtrlValues(int outputCount)
+{
+	auto channelCount = (outputCount > s_minOutputsCount) ? outputCount : s_minOutputsCount;
+
+	for (auto channel = 1; channel <= channelCount; channel++)
+	{
+		setOutputMuteState(channel, false);
+		setOutputGainValue(channel, 1.0f);
+	}
+}
+
+
+#if JUCE_UNIT_TESTS
+
+namespace
+{
+
+// heap allocations made by any thread while counting is switched on, see the counting operator new below
+std::atomic<bool> s_isCountingAllocations{ false };
+std::atomic<int> s_numCountedAllocations{ 0 };
+
+} // namespace
+
+//==============================================================================
+/*
+ * Control values reach the audio thread through the parameter snapshots only,
+ * the device callback must never wait for the control side's m_readLock and
+ * must never allocate, on the audio thread as well as on the render workers.
+ */
+class SurroundFieldMixerProcessorTests : public UnitTest
+{
+public:
+	SurroundFieldMixerProcessorTests() : UnitTest("SurroundFieldMixerProcessor", "SurroundFieldMixer") {}
+
+	void runTest() override
+	{
+		runControlLockTests();
+		runAllocationTests();
+		runStateTests();
+	}
+
+private:
+	void runControlLockTests()
+	{
+		constexpr auto numInputs = 32;
+		constexpr auto numOutputs = 8;
+		constexpr auto blockSize = 256;
+
+		SurroundFieldMixerProcessor processor;
+		// the default device would call back concurrently to the test otherwise, the test takes the role of the audio thread
+		processor.getDeviceManager()->closeAudioDevice();
+		processor.setSpeakerLayout(SpeakerLayout::createRing(numOutputs));
+		processor.setDelayEnabled(true);
+		processor.prepareToPlay(48000.0, blockSize);
+		for (auto channel = 1; channel <= numInputs; channel++)
+		{
+			processor.setInputMuteState(channel, false);
+			processor.setInputGainValue(channel, 1.0f);
+		}
+		for (auto channel = 1; channel <= numOutputs; channel++)
+			processor.setOutputMuteState(channel, false);
+
+		AudioBuffer<float> inputs(numInputs, blockSize);
+		AudioBuffer<float> outputs(numOutputs, blockSize);
+		Random random(1);
+		for (auto channel = 0; channel < numInputs; channel++)
+			for (auto i = 0; i < blockSize; i++)
+				inputs.setSample(channel, i, 0.5f * random.nextFloat() - 0.25f);
+
+		AudioIODeviceCallbackContext context;
+		auto renderBlock = [&] {
+			processor.audioDeviceIOCallbackWithContext(inputs.getArrayOfReadPointers(), numInputs, outputs.getArrayOfWritePointers(), numOutputs, blockSize, context);
+		};
+
+		beginTest("Callbacks complete while the control lock is held");
+		{
+			// the control side holds the lock until the audio side is done, or gives up after a timeout instead of deadlocking the test
+			WaitableEvent lockTaken, blocksRendered;
+			std::thread controlThread([&] {
+				const ScopedLock sl(processor.m_readLock);
+				lockTaken.signal();
+				blocksRendered.wait(5000);
+			});
+
+			lockTaken.wait();
+			auto startTicks = Time::getHighResolutionTicks();
+			for (auto blockIdx = 0; blockIdx < 200; blockIdx++)
+				renderBlock();
+			auto renderTime = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+			blocksRendered.signal();
+			controlThread.join();
+
+			// a single wait would have blocked for the whole timeout
+			expect(renderTime < 4.0, "the audio side waited for the control lock");
+		}
+
+		beginTest("Concurrent control changes are published row by row");
+		{
+			std::atomic<bool> shouldStop{ false };
+			std::thread controlThread([&] {
+				Random controlRandom(2);
+				while (!shouldStop.load())
+				{
+					auto channel = 1 + controlRandom.nextInt(numInputs);
+					processor.setInputPositionValue(channel, juce::Point<float>(controlRandom.nextFloat(), controlRandom.nextFloat()));
+					processor.setInputSpreadValue(channel, controlRandom.nextBool() ? controlRandom.nextFloat() : 0.0f);
+					processor.setInputGainValue(channel, controlRandom.nextFloat());
+					if (controlRandom.nextInt(64) == 0)
+						processor.setOutputGainValue(1 + controlRandom.nextInt(numOutputs), controlRandom.nextFloat());
+				}
+			});
+
+			auto isOutputFinite = true;
+			for (auto blockIdx = 0; blockIdx < 1000; blockIdx++)
+			{
+				renderBlock();
+				for (auto channel = 0; channel < numOutputs; channel++)
+					for (auto i = 0; i < blockSize; i++)
+						isOutputFinite = isOutputFinite && std::isfinite(outputs.getSample(channel, i));
+			}
+			shouldStop = true;
+			controlThread.join();
+			expect(isOutputFinite);
+
+			// the last snapshot picked up by the audio side has to match the control side's tables exactly,
+			// even though each publish only copied the rows that changed
+			renderBlock();
+			auto const& published = processor.m_parameterSnapshots.getReadBuffer();
+			auto const& current = processor.m_parameters;
+			expectEquals(published.getInputCount(), current.getInputCount());
+			expectEquals(published.getMatrixOutputCount(), current.getMatrixOutputCount());
+			expect(published.inputToOutputGains == current.inputToOutputGains);
+			expect(published.inputToOutputDelays == current.inputToOutputDelays);
+			expect(published.inputToOutputDecorrelatedGains == current.inputToOutputDecorrelatedGains);
+			expect(published.inputGains == current.inputGains);
+		}
+
+		processor.releaseResources();
+	}
+
+	void runAllocationTests()
+	{
+		constexpr auto numInputs = 16;
+		constexpr auto numOutputs = 8;
+		constexpr auto blockSize = 256;
+
+		for (auto isDoublePrecision : { false, true })
+		{
+			beginTest(String("No allocations in the callback, ") + (isDoublePrecision ? "double" : "single") + " precision");
+
+			// delay, spread decorrelation, reverb and two render workers, so every render path is taken
+			SurroundFieldMixerProcessor processor;
+			processor.getDeviceManager()->closeAudioDevice();
+			processor.setRenderWorkerCount(2);
+			processor.setDoublePrecisionEnabled(isDoublePrecision);
+			processor.setSpeakerLayout(SpeakerLayout::createRing(numOutputs));
+			processor.setDelayEnabled(true);
+			processor.setSpreadDecorrelationEnabled(true);
+			processor.setReverbEnabled(true);
+			processor.prepareToPlay(48000.0, blockSize);
+
+			// the analyzer threads allocate on their own schedule, only the fifo push on the audio thread is part of the callback
+			processor.m_inputDataAnalyzer->stopThread(1000);
+			processor.m_outputDataAnalyzer->stopThread(1000);
+
+			for (auto channel = 1; channel <= numInputs; channel++)
+			{
+				processor.setInputMuteState(channel, false);
+				processor.setInputGainValue(channel, 1.0f);
+				processor.setInputSpreadValue(channel, channel % 2 == 0 ? 0.5f : 0.0f);
+				processor.setInputReverbValue(channel, 0.3f);
+			}
+			for (auto channel = 1; channel <= numOutputs; channel++)
+				processor.setOutputMuteState(channel, false);
+
+			AudioBuffer<float> inputs(numInputs, blockSize);
+			AudioBuffer<float> outputs(numOutputs, blockSize);
+			Random random(3);
+			AudioIODeviceCallbackContext context;
+
+			// control changes between the callbacks are allowed to allocate, they happen on the control side
+			auto numAllocations = 0;
+			for (auto blockIdx = 0; blockIdx < 400; blockIdx++)
+			{
+				for (auto channel = 0; channel < numInputs; channel++)
+					for (auto i = 0; i < blockSize; i++)
+						inputs.setSample(channel, i, blockIdx < 300 ? 0.5f * random.nextFloat() - 0.25f : 0.0f);
+				if (blockIdx % 10 == 0)
+					processor.setInputPositionValue(1 + random.nextInt(numInputs), juce::Point<float>(random.nextFloat(), random.nextFloat()));
+
+				s_numCountedAllocations = 0;
+				s_isCountingAllocations = true;
+				processor.audioDeviceIOCallbackWithContext(inputs.getArrayOfReadPointers(), numInputs, outputs.getArrayOfWritePointers(), numOutputs, blockSize, context);
+				s_isCountingAllocations = false;
+				numAllocations += s_numCountedAllocations.load();
+			}
+
+			expectEquals(numAllocations, 0);
+			expect(processor.m_renderWorkerPool != nullptr && processor.m_renderWorkerPool->getNumSlots() == 3);
+
+			processor.releaseResources();
+		}
+	}
+
+	void runStateTests()
+	{
+		beginTest("Processing settings survive the state xml");
+
+		SurroundFieldMixerProcessor source;
+		source.getDeviceManager()->closeAudioDevice();
+		auto speakerLayout = SpeakerLayout::createRing(6, 30.0f);
+		speakerLayout.setName("Ring");
+		source.setSpeakerLayout(speakerLayout);
+		source.setDelayEnabled(true);
+		source.setRenderWorkerCount(2);
+		source.setDoublePrecisionEnabled(true);
+		source.setPanningLaw(PanningLaw::VBAP);
+		source.setGainFieldGridEnabled(!source.getGainFieldGridEnabled());
+		source.setReverbEnabled(!source.getReverbEnabled());
+
+		SurroundFieldMixerProcessor target;
+		target.getDeviceManager()->closeAudioDevice();
+		auto stateXml = source.createStateXml();
+		expect(target.setStateXml(stateXml.get()));
+
+		expect(target.getDelayEnabled());
+		expectEquals(target.getRenderWorkerCount(), 2);
+		expect(target.getDoublePrecisionEnabled());
+		expect(target.getPanningLaw() == PanningLaw::VBAP);
+		expect(target.getGainFieldGridEnabled() == source.getGainFieldGridEnabled());
+		expect(target.getReverbEnabled() == source.getReverbEnabled());
+
+		auto targetLayout = target.getSpeakerLayout();
+		expectEquals(targetLayout.getName(), String("Ring"));
+		expectEquals(targetLayout.getNumSpeakers(), 6);
+		for (auto speakerIdx = 0; speakerIdx < targetLayout.getNumSpeakers(); speakerIdx++)
+			expect(targetLayout.getSpeakerPosition(speakerIdx).getDistanceFrom(speakerLayout.getSpeakerPosition(speakerIdx)) < 0.0001f);
+
+		// settings missing from the xml are left alone, foreign xml is rejected
+		auto partialXml = std::make_unique<XmlElement>(SurroundFieldMixerProcessor::s_stateTagName);
+		partialXml->setAttribute("delayEnabled", 0);
+		expect(target.setStateXml(partialXml.get()));
+		expect(!target.getDelayEnabled());
+		expectEquals(target.getRenderWorkerCount(), 2);
+		expect(target.getPanningLaw() == PanningLaw::VBAP);
+		expectEquals(target.getSpeakerLayout().getNumSpeakers(), 6);
+
+		XmlElement foreignXml("FOREIGN");
+		foreignXml.setAttribute("delayEnabled", 1);
+		expect(!target.setStateXml(&foreignXml));
+		expect(!target.getDelayEnabled());
+	}
+};
+
+static SurroundFieldMixerProcessorTests surroundFieldMixerProcessorTests;
+
+#endif
+
+} // namespace SurroundFieldMixer
+
+#if JUCE_UNIT_TESTS
+
+//==============================================================================
+// counts the heap allocations for the allocation tests above, the array and nothrow forms end up here as well
+void* operator new(std::size_t size)
+{
+	if (SurroundFieldMixer::s_isCountingAllocations.load(std::memory_order_relaxed))
+		SurroundFieldMixer::s_numCountedAllocations++;
+
+	if (auto memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+#endif
@@ -20,20 +20,38 @@
 
 #include <JuceHeader.h>
 
+#include "AudioMemoryArena.h"
+#include "FeedbackDelayNetwork.h"
+#include "GainFieldGrid.h"
+#include "MatrixMixKernel.h"
+#include "MatrixRenderWorkerPool.h"
+#include "OutputLayouts.h"
 #include "ProcessorDataAnalyzer.h"
+#include "ProcessorParameterSnapshot.h"
+#include "SpeakerLayout.h"
+#include "SpreadDecorrelator.h"
+#include "TripleBuffer.h"
+#include "VBAPPanner.h"
 #include "../SurroundFieldMixerEditor/SurroundFieldMixerEditor.h"
 
 
 namespace SurroundFieldMixer
 {
 
+//==============================================================================
+// how the gains of an input to the speakers are derived from its position
+enum class PanningLaw
+{
+    Distance,   // 1 - distance to each speaker, every speaker within reach gets signal
+    VBAP,       // vector base amplitude panning between the two speakers around the source direction
+};
 
 //==============================================================================
 /*
 */
 class SurroundFieldMixerProcessor : public AudioProcessor,
 					                public AudioIODeviceCallback,
-                                    public MessageListener
+                                    public ProcessorDataAnalyzer::Listener
 {
 public:
     class ChannelCommander
@@ -186,6 +204,40 @@ public:
     float getOutputGainValue(int channelNumber);
     void setOutputGainValue(int channelNumber, float value, ChannelCommander* sender = nullptr);
 
+    bool getDelayEnabled();
+    void setDelayEnabled(bool enabled);
+
+    OutputLayout getOutputLayout();
+    void setOutputLayout(OutputLayout layout);
+
+    PanningLaw getPanningLaw();
+    void setPanningLaw(PanningLaw panningLaw);
+
+    bool getGainFieldGridEnabled();
+    void setGainFieldGridEnabled(bool enabled);
+
+    bool getSpreadDecorrelationEnabled();
+    void setSpreadDecorrelationEnabled(bool enabled);
+
+    bool getReverbEnabled();
+    void setReverbEnabled(bool enabled);
+
+    SpeakerLayout getSpeakerLayout();
+    void setSpeakerLayout(const SpeakerLayout& speakerLayout);
+    bool loadSpeakerLayout(const File& file);
+
+    int getRenderWorkerCount();
+    void setRenderWorkerCount(int workerCount);
+
+    bool getAudioMemoryLockEnabled();
+    void setAudioMemoryLockEnabled(bool enabled);
+
+    bool getDoublePrecisionEnabled();
+    void setDoublePrecisionEnabled(bool enabled);
+
+    // instruction set the matrix mix kernel picked for the running cpu, for display and logging
+    String getMixKernelInstructionSetName() const;
+
 
     //==============================================================================
     AudioDeviceManager* getDeviceManager();
@@ -195,6 +247,8 @@ public:
     void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override;
     void releaseResources() override;
     void processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+    void processBlock(AudioBuffer<double>& buffer, MidiBuffer& midiMessages) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     double getTailLengthSeconds() const override;
     bool acceptsMidi() const override;
@@ -212,6 +266,10 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+    // the processing settings, stored in the app configuration and in the plugin state
+    std::unique_ptr<XmlElement> createStateXml();
+    bool setStateXml(XmlElement* stateXml);
+
     //==============================================================================
     void audioDeviceIOCallbackWithContext (const float* const* inputChannelData,
                                            int numInputChannels,
@@ -227,7 +285,7 @@ public:
     float getInputToOutputGain(int input, int output);
 
     //==============================================================================
-    void handleMessage(const Message& message) override;
+    void processingDataChanged(AbstractProcessorData* data) override;
 
     //==============================================================================
     enum dBRange
@@ -246,18 +304,30 @@ public:
         return dBRange::max;
     }
 
-    static constexpr int s_maxChannelCount = 64;
-    static constexpr int s_maxNumSamples = 1024;
+    static constexpr int s_maxChannelCount = 256; // upper limit of device channels opened, processing is sized to what the device actually offers
+    static constexpr int s_defaultChannelCapacity = 64;
 
     static constexpr int s_minInputsCount = 1;
     static constexpr int s_minOutputsCount = 5;
 
+    static constexpr double s_gainRampTimeSeconds = 0.02;
+    static constexpr double s_delayRampTimeSeconds = 0.05;
+
+    static constexpr float s_fieldSizeMeters = 10.0f; // edge length the normalized 0..1 field positions are mapped to
+    static constexpr float s_speedOfSound = 343.0f;
+
+    static constexpr int s_numSpreadSources = 7; // virtual sources the footprint of a spread input is averaged from
+
+    static constexpr float s_minCellGain = 0.00001f; // -100dB, cells below are treated as silent
+    static constexpr float s_silenceThreshold = 0.0000001f; // -140dB
+
+    static constexpr int s_maxRenderWorkerCount = 3;
+    static constexpr int s_minSamplesForParallelRender = 64;
+    static constexpr int s_minActiveCellsForParallelRender = 64;
+
     static constexpr juce::Point<float> s_defaultPos(){return juce::Point<float>(0.5f, 0.5f);};
-    juce::Point<float> m_leftPos;
-    juce::Point<float> m_rightPos;
-    juce::Point<float> m_centerPos;
-    juce::Point<float> m_leftSurroundPos;
-    juce::Point<float> m_rightSurroundPos;
+
+    static constexpr const char* s_stateTagName = "PROCESSING";
 
 protected:
     //==============================================================================
@@ -265,11 +335,141 @@ protected:
     void initializeOutputCtrlValues(int outputCount);
 
 private:
-    const juce::Point<float> getInputPosition(int channelNumber);
-    const juce::Point<float> getOutputPosition(int channelNumber);
+    friend class SurroundFieldMixerProcessorTests;
+
+    void applySpeakerLayout(const SpeakerLayout& speakerLayout);
+    void requestGainFieldGrid();
+    void computeSourceGains(const juce::Point<float>& position, float* gains, int numGains);
+    void computeSpreadGains(const juce::Point<float>& position, float spread, float* gains, int numGains);
+    static void computePanningGains(PanningLaw panningLaw, const SpeakerLayout& speakerLayout, const VBAPPanner& vbapPanner, const juce::Point<float>& position, float* gains, int numGains);
 
     //==============================================================================
-    const juce::Point<float> getNormalizedDefaultPosition(juce::AudioChannelSet::ChannelType channelIdent);
+    // per render slot sample type dependent working data, slot 0 is the audio thread and the render pool workers follow
+    template <typename SampleType>
+    struct RenderJobBuffers
+    {
+        std::vector<SampleType*>    outputChannels;
+        SampleType*                 delayReadBuffer{ nullptr };
+        // the workers render their output ranges in here, the audio thread copies them into the device outputs.
+        // Empty for slot 0, which renders into the device outputs directly.
+        std::vector<SampleType*>    outputScratchChannels;
+    };
+
+    // all sample type dependent working data of the render path. The float set is always prepared,
+    // the double set only when the processor is prepared for double precision.
+    template <typename SampleType>
+    struct RenderBuffers
+    {
+        std::vector<SampleType*>            inputScratchChannels;
+        AudioBuffer<SampleType>             inputScratchBuffer;
+        // per input the samples the matrix reads, either the device data itself or the gained copy in inputScratchBuffer
+        std::vector<const SampleType*>      inputChannels;
+        // channel pointers into the current device block, for blocks that are larger than the prepared capacity
+        std::vector<const SampleType*>      subBlockInputChannels;
+        std::vector<SampleType*>            subBlockOutputChannels;
+        // per input the all-pass filtered copy of inputChannels, only filled for inputs that are rendered with decorrelation
+        std::vector<SampleType*>            decorrelatedChannels;
+        // sum of all reverb sends and the line outputs of the reverb network it is fed into
+        SampleType*                         reverbSendBus{ nullptr };
+        std::vector<SampleType*>            reverbLineChannels;
+        // one ring per input, all rings share the write position
+        SampleType*                         delayLines{ nullptr };
+        // the same rings for the decorrelated part of spread inputs, read with the same cell delays
+        SampleType*                         decorrelatedDelayLines{ nullptr };
+        std::vector<RenderJobBuffers<SampleType>> jobs;
+        // the outputs of the block currently rendered
+        SampleType* const*                  outputChannelData{ nullptr };
+        // widened copies of the single precision device channels, only used for double precision
+        std::vector<SampleType*>            conversionInputChannels;
+        std::vector<SampleType*>            conversionOutputChannels;
+    };
+
+    template <typename SampleType>
+    RenderBuffers<SampleType>& getRenderBuffers();
+    template <typename SampleType>
+    size_t getRenderBuffersMemorySize(int numJobs, bool withDeviceConversion) const;
+    template <typename SampleType>
+    void prepareRenderBuffers(int numJobs, bool withDeviceConversion);
+    template <typename SampleType>
+    void releaseRenderBuffers();
+    size_t getCellStateMemorySize() const;
+    void prepareCellState(double sampleRate);
+    void releaseCellState();
+
+    //==============================================================================
+    template <typename SampleType>
+    void renderBlock(const SampleType* const* inputChannelData, int numInputChannels, SampleType* const* outputChannelData, int numOutputChannels, int numSamples);
+    void renderDeviceBlockInDoublePrecision(const float* const* inputChannelData, int numInputChannels, float* const* outputChannelData, int numOutputChannels, int numSamples);
+
+    //==============================================================================
+    template <typename SampleType>
+    void writeDelayLines(const SampleType* const* inputChannelData, int numInputs, int numSamples);
+    template <typename SampleType>
+    void writeDelayLine(SampleType* delayLine, const SampleType* data, int numSamples);
+    template <typename SampleType>
+    void readDelayLine(const SampleType* delayLine, float delayInSamples, int numSamples, SampleType* destination);
+    template <typename SampleType>
+    void readDelayLineRamped(const SampleType* delayLine, float startDelayInSamples, float endDelayInSamples, int numSamples, SampleType* destination);
+    float getCellDelayInSamples(const ProcessorParameterSnapshot& parameters, int inputIdx, int outputIdx) const;
+
+    //==============================================================================
+    void rebuildActiveCells(const ProcessorParameterSnapshot& parameters, int numInputs, int numOutputs);
+
+    //==============================================================================
+    template <typename SampleType>
+    int decorrelateInputs(const ProcessorParameterSnapshot& parameters, int numInputs, int numSamples);
+    template <typename SampleType>
+    void mixDecorrelatedInputs(const ProcessorParameterSnapshot& parameters, int numOutputs, int numSamples);
+
+    //==============================================================================
+    template <typename SampleType>
+    bool sendInputsToReverb(const ProcessorParameterSnapshot& parameters, int numInputs, int numSamples);
+    template <typename SampleType>
+    void renderReverbNetwork();
+    template <typename SampleType>
+    void mixReverbReturn(const ProcessorParameterSnapshot& parameters, int numOutputs, int numSamples);
+
+    //==============================================================================
+    // per render slot working data, so output ranges can be rendered concurrently
+    struct RenderScratch
+    {
+        std::vector<float>  startGains;
+        std::vector<float>  endGains;
+        std::vector<int>    outputIndices;
+    };
+
+    // everything a render job needs to know about the current block
+    struct RenderContext
+    {
+        const ProcessorParameterSnapshot*   parameters{ nullptr };
+        int                                 numOutputs{ 0 };
+        int                                 numSamples{ 0 };
+        int                                 numJobs{ 1 };
+        bool                                useDelayPath{ false };
+        bool                                useLayoutPath{ false };
+    };
+
+    // render jobs only read shared state and write into their slot, so a job taken over from a late worker can be rendered again
+    template <typename SampleType>
+    static void renderJob(void* context, int jobIdx, int slotIdx);
+    template <typename SampleType>
+    static void renderReverbJob(void* context);
+    Range<int> getJobOutputRange(int jobIdx) const;
+    template <typename SampleType>
+    void renderOutputRange(int outputBegin, int outputEnd, int slotIdx);
+    template <typename SampleType, OutputLayout Layout>
+    void renderLayoutOutputs(SampleType* const* outputChannelData);
+    void advanceCellRamps(const ProcessorParameterSnapshot& parameters, int numSamples);
+    template <typename SampleType>
+    void mixDelayedInputToOutputs(const SampleType* delayLine, const SmoothedValue<float>* delayRamps, int inputIdx, const int* activeOutputs, int numActiveOutputs, RenderScratch& scratch, RenderJobBuffers<SampleType>& jobBuffers);
+
+    //==============================================================================
+    void setParameterInputCount(int minimumInputCount);
+    void setParameterOutputCount(int minimumOutputCount);
+    void setParameterMatrixOutputCount(int matrixOutputCount);
+    void updateInputToOutputGains(int inputIdx);
+    void updateAllInputToOutputGains();
+    void publishParameters();
 
     //==============================================================================
     String                      m_Name;
@@ -277,7 +477,18 @@ private:
     //==============================================================================
     CriticalSection     m_readLock;
 
-    float**             m_processorChannels;
+    int                 m_maxSamplesPerBlock{ 0 };
+    int                 m_channelCapacity{ s_defaultChannelCapacity };
+    int                 m_inputCapacity{ s_defaultChannelCapacity };
+    int                 m_outputCapacity{ s_defaultChannelCapacity };
+    // all working audio memory (input scratch, delay lines, render scratch, analyzer fifos) is taken from here.
+    // Declared before the analyzers, so it outlives their fifos.
+    AudioMemoryArena    m_audioMemory;
+    bool                m_audioMemoryLockEnabled{ false };
+    // single precision is the default, double precision costs twice the memory bandwidth in the mix
+    bool                m_isDoublePrecisionPrepared{ false };
+    RenderBuffers<float>    m_floatRenderBuffers;
+    RenderBuffers<double>   m_doubleRenderBuffers;
 
     //==============================================================================
     std::unique_ptr<AudioDeviceManager> m_deviceManager;
@@ -307,10 +518,97 @@ private:
     //==============================================================================
     std::map<int, juce::Point<float>>  m_inputPositionValues;
 
+    //==============================================================================
+    ProcessorParameterSnapshot                  m_parameters;
+    TripleBuffer<ProcessorParameterSnapshot>    m_parameterSnapshots;
+
+    //==============================================================================
+    // guarded by m_readLock, the audio thread only sees the gain and delay rows derived from them
+    OutputLayout        m_outputLayout{ OutputLayout::Surround50 }; // Generic for speaker layouts that are not one of the fixed ones
+    SpeakerLayout       m_speakerLayout;
+    PanningLaw          m_panningLaw{ PanningLaw::Distance };
+    VBAPPanner          m_vbapPanner;
+
+    //==============================================================================
+    // optional precomputed gains of the current speaker layout and panning law, built in the background.
+    // Guarded by m_readLock, m_gainFieldGridRequestId tells the builder results of outdated requests apart.
+    bool                                m_gainFieldGridEnabled{ false };
+    std::unique_ptr<GainFieldGrid>      m_gainFieldGrid;
+    uint32                              m_gainFieldGridRequestId{ 0 };
+    GainFieldGridBuilder                m_gainFieldGridBuilder;
+    std::vector<float>                  m_spreadGainScratch;
+
+    //==============================================================================
+    MatrixMixKernel     m_mixKernel;
+
+    //==============================================================================
+    // audio thread only. Input ramps carry input gain and mute, the matrix cell ramps carry
+    // the cell gain multiplied with output gain and mute. The cell state is taken from the audio memory,
+    // m_inputCapacity rows with a fixed m_outputCapacity row stride.
+    std::vector<SmoothedValue<float>>   m_inputGainRamps;
+    SmoothedValue<float>*               m_cellGainRamps{ nullptr };
+
+    //==============================================================================
+    // audio thread only. Per input the outputs whose cell gain is audible or still ramping,
+    // rebuilt when the parameters change or a cell ramp has settled.
+    int*                                m_activeCellOutputs{ nullptr };
+    std::vector<int>                    m_activeCellCounts;
+    std::vector<int>                    m_inputSilentSampleCounts;
+    std::vector<int>                    m_renderedInputs;
+    int                                 m_numRenderedInputs{ 0 };
+    int                                 m_activeCellInputCount{ 0 };
+    int                                 m_activeCellOutputCount{ 0 };
+    bool                                m_isActiveCellListDirty{ true };
+
+    //==============================================================================
+    // audio thread only. The rings themselves live in the render buffers of the prepared sample type.
+    double                              m_sampleRate{ 0.0 };
+    int                                 m_delayLineLength{ 0 };
+    int                                 m_delayLineMask{ 0 };
+    int                                 m_delayLineWritePos{ 0 };
+    float                               m_maxDelayInSamples{ 0.0f };
+    SmoothedValue<float>*               m_cellDelayRamps{ nullptr };
+    bool                                m_isDelayPathActive{ false };
+
+    //==============================================================================
+    // audio thread only. The decorrelated part of spread inputs is mixed after the matrix, through its own delay
+    // rings at the same cell delays. Its gain and delay ramps use the same row stride as the matrix cells.
+    SpreadDecorrelator                  m_spreadDecorrelator;
+    SmoothedValue<float>*               m_decorrelatedGainRamps{ nullptr };
+    SmoothedValue<float>*               m_decorrelatedDelayRamps{ nullptr };
+    std::vector<bool>                   m_isDecorrelatedPartActive;
+    std::vector<bool>                   m_isInputDecorrelated;      // filtered in the previous block
+    std::vector<int>                    m_decorrelatedInputs;
+    int                                 m_numDecorrelatedInputs{ 0 };
+
+    //==============================================================================
+    // audio thread only. One reverb network is shared by all inputs, fed by the ramped input sends and
+    // returned to the full range outputs. Its tap gains are gathered per line with a fixed m_channelCapacity stride.
+    FeedbackDelayNetwork                m_reverbNetwork;
+    std::vector<SmoothedValue<float>>   m_reverbSendRamps;
+    std::vector<SmoothedValue<float>>   m_reverbReturnRamps;
+    std::vector<float>                  m_reverbTapStartGains;
+    std::vector<float>                  m_reverbTapEndGains;
+    int                                 m_reverbSilentSampleCount{ 0 };
+    int                                 m_reverbTailLength{ 0 };
+
+    //==============================================================================
+    // the output range of the matrix is split into jobs of whole mix kernel output groups,
+    // the audio thread renders one of them itself. Without workers everything is one job.
+    int                                     m_renderWorkerCount{ 0 }; // off by default, -1 picks a count from the available cpus
+    std::unique_ptr<MatrixRenderWorkerPool> m_renderWorkerPool;
+    std::vector<RenderScratch>              m_renderScratches;
+    RenderContext                           m_renderContext;
+
     //==============================================================================
     std::unique_ptr<SurroundFieldMixerEditor>  m_processorEditor;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SurroundFieldMixerProcessor)
 };
 
+template <>
+SurroundFieldMixerProcessor::RenderBuffers<float>& SurroundFieldMixerProcessor::getRenderBuffers<float>();
+template <>
+SurroundFieldMixerProcessor::RenderBuffers<double>& SurroundFieldMixerProcessor::getRenderBuffers<double>();
+
 } // namespace SurroundFieldMixer
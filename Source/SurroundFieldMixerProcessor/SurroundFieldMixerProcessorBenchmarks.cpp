@@ -0,0 +1,344 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SurroundFieldMixerProcessor.h"
+
+namespace SurroundFieldMixer
+{
+
+#if JUCE_UNIT_TESTS
+
+namespace
+{
+
+constexpr double s_benchmarkSampleRate = 48000.0;
+constexpr int s_benchmarkBlockSize = 512;
+
+//==============================================================================
+/*
+ * Prepares a processor the benchmark drives itself, every input is placed
+ * somewhere else on the field so most cells of the matrix are active.
+ */
+void prepareBenchmarkProcessor(SurroundFieldMixerProcessor& processor, int numInputs, int numOutputs)
+{
+	// the default device would call back concurrently to the benchmark otherwise
+	processor.getDeviceManager()->closeAudioDevice();
+
+	processor.setSpeakerLayout(SpeakerLayout::createRing(numOutputs));
+	processor.prepareToPlay(s_benchmarkSampleRate, s_benchmarkBlockSize);
+
+	for (auto channel = 1; channel <= numInputs; channel++)
+	{
+		auto azimuth = 360.0f * static_cast<float>(channel) / static_cast<float>(numInputs);
+		processor.setInputMuteState(channel, false);
+		processor.setInputGainValue(channel, 1.0f);
+		processor.setInputPositionValue(channel, SpeakerLayout::getPositionFromAzimuth(azimuth, 0.5f + 0.4f * static_cast<float>(channel % 2)));
+	}
+	for (auto channel = 1; channel <= numOutputs; channel++)
+	{
+		processor.setOutputMuteState(channel, false);
+		processor.setOutputGainValue(channel, 1.0f);
+	}
+}
+
+void fillWithNoise(AudioBuffer<float>& buffer, Random& random)
+{
+	for (auto channel = 0; channel < buffer.getNumChannels(); channel++)
+		for (auto i = 0; i < buffer.getNumSamples(); i++)
+			buffer.setSample(channel, i, 0.5f * random.nextFloat() - 0.25f);
+}
+
+// average time in microseconds of rendering one block with the given function, after 50 warmup blocks
+template <typename Function>
+double measureTime(int numBlocks, Function&& render)
+{
+	for (auto blockIdx = 0; blockIdx < 50; blockIdx++)
+		render();
+
+	auto startTicks = Time::getHighResolutionTicks();
+	for (auto blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+		render();
+
+	return 1000000.0 * Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) / numBlocks;
+}
+
+// average time of one device callback in microseconds, after the gain ramps have settled
+double measureCallbackTime(SurroundFieldMixerProcessor& processor, const AudioBuffer<float>& inputs, AudioBuffer<float>& outputs, int numBlocks)
+{
+	AudioIODeviceCallbackContext context;
+	return measureTime(numBlocks, [&] {
+		processor.audioDeviceIOCallbackWithContext(inputs.getArrayOfReadPointers(), inputs.getNumChannels(), outputs.getArrayOfWritePointers(), outputs.getNumChannels(), outputs.getNumSamples(), context);
+	});
+}
+
+} // namespace
+
+//==============================================================================
+/*
+ * Render time of the 64 x 16 matrix with 0 to 3 render workers, i.e. on up to
+ * four cores. The parallel render has to produce the same output as the
+ * single threaded one.
+ */
+class RenderWorkerScalingBenchmark : public UnitTest
+{
+public:
+	RenderWorkerScalingBenchmark() : UnitTest("Render worker scaling", "SurroundFieldMixerBenchmarks") {}
+
+	void runTest() override
+	{
+		beginTest("64 inputs x 16 outputs, 0 to 3 workers");
+
+		constexpr auto numInputs = 64;
+		constexpr auto numOutputs = 16;
+		constexpr auto numBlocks = 2000;
+
+		if (SystemStats::getNumCpus() < SurroundFieldMixerProcessor::s_maxRenderWorkerCount + 1)
+			logMessage("only " + String(SystemStats::getNumCpus()) + " cpus, the workers share cores with the audio thread");
+
+		Random random(1);
+		AudioBuffer<float> inputs(numInputs, s_benchmarkBlockSize);
+		fillWithNoise(inputs, random);
+
+		AudioBuffer<float> singleThreadedOutputs(numOutputs, s_benchmarkBlockSize);
+		auto singleThreadedTime = 0.0;
+		for (auto workerCount = 0; workerCount <= SurroundFieldMixerProcessor::s_maxRenderWorkerCount; workerCount++)
+		{
+			SurroundFieldMixerProcessor processor;
+			processor.setRenderWorkerCount(workerCount);
+			prepareBenchmarkProcessor(processor, numInputs, numOutputs);
+
+			AudioBuffer<float> outputs(numOutputs, s_benchmarkBlockSize);
+			auto callbackTime = measureCallbackTime(processor, inputs, outputs, numBlocks);
+			if (workerCount == 0)
+			{
+				singleThreadedTime = callbackTime;
+				singleThreadedOutputs.makeCopyOf(outputs);
+			}
+
+			logMessage(String(workerCount) + " workers: " + String(callbackTime, 1) + " us per block, x" + String(singleThreadedTime / callbackTime, 2));
+
+			auto maxDifference = 0.0f;
+			for (auto channel = 0; channel < numOutputs; channel++)
+				for (auto i = 0; i < s_benchmarkBlockSize; i++)
+					maxDifference = jmax(maxDifference, std::abs(outputs.getSample(channel, i) - singleThreadedOutputs.getSample(channel, i)));
+			expectEquals(maxDifference, 0.0f);
+
+			processor.releaseResources();
+		}
+	}
+};
+
+static RenderWorkerScalingBenchmark renderWorkerScalingBenchmark;
+
+//==============================================================================
+/*
+ * The grouped mix kernel against the per cell addFrom loop it replaced, for
+ * 8, 32 and 64 inputs into 16 outputs with every cell audible. Both have to
+ * sum up to the same outputs.
+ */
+class MixKernelBenchmark : public UnitTest
+{
+public:
+	MixKernelBenchmark() : UnitTest("Mix kernel", "SurroundFieldMixerBenchmarks") {}
+
+	void runTest() override
+	{
+		constexpr auto numOutputs = 16;
+		constexpr auto numBlocks = 2000;
+
+		MatrixMixKernel mixKernel;
+		logMessage("instruction set: " + MatrixMixKernel::getInstructionSetName(mixKernel.getInstructionSet()));
+
+		for (auto numInputs : { 8, 32, 64 })
+		{
+			beginTest(String(numInputs) + " inputs x " + String(numOutputs) + " outputs");
+
+			Random random(1);
+			AudioBuffer<float> inputs(numInputs, s_benchmarkBlockSize);
+			fillWithNoise(inputs, random);
+			std::vector<float> gains(static_cast<size_t>(numInputs * numOutputs));
+			for (auto& gain : gains)
+				gain = random.nextFloat();
+
+			// one addFrom per input/output pair, the input block is loaded once for every output
+			AudioBuffer<float> loopOutputs(numOutputs, s_benchmarkBlockSize);
+			auto loopTime = measureTime(numBlocks, [&] {
+				loopOutputs.clear();
+				for (auto inputIdx = 0; inputIdx < numInputs; inputIdx++)
+					for (auto outputIdx = 0; outputIdx < numOutputs; outputIdx++)
+						loopOutputs.addFrom(outputIdx, 0, inputs.getReadPointer(inputIdx), s_benchmarkBlockSize, gains[static_cast<size_t>(inputIdx * numOutputs + outputIdx)]);
+			});
+
+			AudioBuffer<float> kernelOutputs(numOutputs, s_benchmarkBlockSize);
+			auto kernelTime = measureTime(numBlocks, [&] {
+				kernelOutputs.clear();
+				for (auto inputIdx = 0; inputIdx < numInputs; inputIdx++)
+					mixKernel.mixInputToOutputs(inputs.getReadPointer(inputIdx), kernelOutputs.getArrayOfWritePointers(), gains.data() + inputIdx * numOutputs, numOutputs, s_benchmarkBlockSize);
+			});
+
+			logMessage("addFrom loop: " + String(loopTime, 1) + " us per block, mix kernel: " + String(kernelTime, 1) + " us per block, x" + String(loopTime / kernelTime, 2));
+
+			auto maxDifference = 0.0f;
+			for (auto channel = 0; channel < numOutputs; channel++)
+				for (auto i = 0; i < s_benchmarkBlockSize; i++)
+					maxDifference = jmax(maxDifference, std::abs(kernelOutputs.getSample(channel, i) - loopOutputs.getSample(channel, i)));
+			expectLessOrEqual(maxDifference, 1.0e-4f);
+		}
+	}
+};
+
+static MixKernelBenchmark mixKernelBenchmark;
+
+//==============================================================================
+/*
+ * Render time while the delay, spread and reverb tails decay after the inputs
+ * went silent. With denormals flushed the decay must not cost more than
+ * playing, and the outputs have to end up exactly silent.
+ */
+class DecayToSilenceBenchmark : public UnitTest
+{
+public:
+	DecayToSilenceBenchmark() : UnitTest("Decay to silence", "SurroundFieldMixerBenchmarks") {}
+
+	void runTest() override
+	{
+		beginTest("16 inputs x 8 outputs with delay, spread and reverb");
+
+		constexpr auto numInputs = 16;
+		constexpr auto numOutputs = 8;
+		constexpr auto blocksPerWindow = static_cast<int>(s_benchmarkSampleRate / 2) / s_benchmarkBlockSize; // about half a second
+		constexpr auto numDecayWindows = 14;
+
+		SurroundFieldMixerProcessor processor;
+		processor.setDelayEnabled(true);
+		processor.setSpreadDecorrelationEnabled(true);
+		processor.setReverbEnabled(true);
+		prepareBenchmarkProcessor(processor, numInputs, numOutputs);
+		for (auto channel = 1; channel <= numInputs; channel++)
+		{
+			processor.setInputSpreadValue(channel, channel % 2 == 0 ? 0.6f : 0.0f);
+			processor.setInputReverbValue(channel, 0.5f);
+		}
+
+		Random random(1);
+		AudioBuffer<float> inputs(numInputs, s_benchmarkBlockSize);
+		AudioBuffer<float> outputs(numOutputs, s_benchmarkBlockSize);
+
+		AudioIODeviceCallbackContext context;
+		auto renderBlock = [&] {
+			processor.audioDeviceIOCallbackWithContext(inputs.getArrayOfReadPointers(), numInputs, outputs.getArrayOfWritePointers(), numOutputs, s_benchmarkBlockSize, context);
+		};
+
+		// the noise is changed every block, so the playing time includes filling the tails
+		auto playingTime = measureTime(4 * blocksPerWindow, [&] {
+			fillWithNoise(inputs, random);
+			renderBlock();
+		});
+		logMessage("playing: " + String(playingTime, 1) + " us per block");
+
+		// the decay is timed in consecutive windows without warmup blocks in between
+		inputs.clear();
+		auto maxDecayTime = 0.0;
+		for (auto windowIdx = 0; windowIdx < numDecayWindows; windowIdx++)
+		{
+			auto startTicks = Time::getHighResolutionTicks();
+			for (auto blockIdx = 0; blockIdx < blocksPerWindow; blockIdx++)
+				renderBlock();
+			auto windowTime = 1000000.0 * Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) / blocksPerWindow;
+			maxDecayTime = jmax(maxDecayTime, windowTime);
+			logMessage("decaying " + String(0.5 * windowIdx, 1) + "s to " + String(0.5 * (windowIdx + 1), 1) + "s: " + String(windowTime, 1) + " us per block, peak " + String(Decibels::gainToDecibels(outputs.getMagnitude(0, s_benchmarkBlockSize)), 1) + " dB");
+		}
+
+		// the tails are dropped once they are inaudible, so the outputs are exact zeros and nothing is left to render
+		expectEquals(outputs.getMagnitude(0, s_benchmarkBlockSize), 0.0f);
+		expectLessOrEqual(maxDecayTime, 2.0 * playingTime);
+
+		processor.releaseResources();
+	}
+};
+
+static DecayToSilenceBenchmark decayToSilenceBenchmark;
+
+//==============================================================================
+/*
+ * Cost of the double precision render path against the single precision
+ * default, for the plain matrix and with delay and reverb tails. The device
+ * callbacks include the conversion to double and back.
+ */
+class PrecisionModeBenchmark : public UnitTest
+{
+public:
+	PrecisionModeBenchmark() : UnitTest("Precision mode", "SurroundFieldMixerBenchmarks") {}
+
+	void runTest() override
+	{
+		constexpr auto numInputs = 64;
+		constexpr auto numOutputs = 16;
+		constexpr auto numBlocks = 1000;
+
+		Random random(1);
+		AudioBuffer<float> inputs(numInputs, s_benchmarkBlockSize);
+		fillWithNoise(inputs, random);
+
+		for (auto withTails : { false, true })
+		{
+			beginTest(String(numInputs) + " inputs x " + String(numOutputs) + " outputs" + (withTails ? ", delay and reverb" : ""));
+
+			AudioBuffer<float> singlePrecisionOutputs(numOutputs, s_benchmarkBlockSize);
+			auto singlePrecisionTime = 0.0;
+			for (auto isDoublePrecision : { false, true })
+			{
+				SurroundFieldMixerProcessor processor;
+				processor.setDoublePrecisionEnabled(isDoublePrecision);
+				processor.setDelayEnabled(withTails);
+				processor.setReverbEnabled(withTails);
+				prepareBenchmarkProcessor(processor, numInputs, numOutputs);
+				if (withTails)
+					for (auto channel = 1; channel <= numInputs; channel++)
+						processor.setInputReverbValue(channel, 0.5f);
+
+				AudioBuffer<float> outputs(numOutputs, s_benchmarkBlockSize);
+				auto callbackTime = measureCallbackTime(processor, inputs, outputs, numBlocks);
+				if (!isDoublePrecision)
+				{
+					singlePrecisionTime = callbackTime;
+					singlePrecisionOutputs.makeCopyOf(outputs);
+					logMessage("single precision: " + String(callbackTime, 1) + " us per block");
+				}
+				else
+				{
+					// both modes render the same mix, they only differ by the rounding of the single precision sums
+					auto maxDifference = 0.0f;
+					for (auto channel = 0; channel < numOutputs; channel++)
+						for (auto i = 0; i < s_benchmarkBlockSize; i++)
+							maxDifference = jmax(maxDifference, std::abs(outputs.getSample(channel, i) - singlePrecisionOutputs.getSample(channel, i)));
+					logMessage("double precision: " + String(callbackTime, 1) + " us per block, x" + String(callbackTime / singlePrecisionTime, 2) + ", max difference " + String(maxDifference));
+					expectLessOrEqual(maxDifference, 1.0e-3f);
+				}
+
+				processor.releaseResources();
+			}
+		}
+	}
+};
+
+static PrecisionModeBenchmark precisionModeBenchmark;
+
+#endif
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,95 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Single writer / single reader exchange of a value of type T without locks.
+ * The writer fills getWriteBuffer() and calls publish(), the reader calls
+ * update() to pick up the most recent published value and accesses it via
+ * getReadBuffer(). Neither side ever blocks or allocates, intermediate values
+ * the reader did not pick up in time are simply skipped.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    //==============================================================================
+    T& getWriteBuffer()
+    {
+        return m_buffers[m_writeIndex];
+    }
+
+    void publish()
+    {
+        auto previousMiddle = m_middle.exchange(m_writeIndex | s_dirtyFlag, std::memory_order_acq_rel);
+        m_writeIndex = previousMiddle & s_indexMask;
+    }
+
+    //==============================================================================
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & s_dirtyFlag) == 0)
+            return false;
+
+        auto previousMiddle = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previousMiddle & s_indexMask;
+        return true;
+    }
+
+    T& getReadBuffer()
+    {
+        return m_buffers[m_readIndex];
+    }
+
+    const T& getReadBuffer() const
+    {
+        return m_buffers[m_readIndex];
+    }
+
+    //==============================================================================
+    // calls function with each of the three buffers, e.g. to reserve memory in all of them up front.
+    // Only valid while neither side is using the buffer, any of them may end up on either side later on.
+    template <typename Function>
+    void forEachBuffer(Function&& function)
+    {
+        for (auto& buffer : m_buffers)
+            function(buffer);
+    }
+
+private:
+    static constexpr int s_indexMask = 0x3;
+    static constexpr int s_dirtyFlag = 0x4;
+
+    std::array<T, 3>    m_buffers;
+    int                 m_writeIndex{ 0 };
+    std::atomic<int>    m_middle{ 1 };
+    int                 m_readIndex{ 2 };
+};
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,214 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "VBAPPanner.h"
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+VBAPPanner::VBAPPanner()
+{
+}
+
+VBAPPanner::~VBAPPanner()
+{
+}
+
+void VBAPPanner::setSpeakerLayout(const SpeakerLayout& speakerLayout)
+{
+	// must not be called while computeGains is in use, the processor does both under its control lock
+	m_numSpeakers = speakerLayout.getNumSpeakers();
+	m_pannedSpeakers.clear();
+	m_speakerPairs.clear();
+	m_lookup.fill(-1);
+
+	struct DirectionalSpeaker
+	{
+		float   azimuth;
+		float   distance;
+		int     speakerIdx;
+	};
+	std::vector<DirectionalSpeaker> directionalSpeakers;
+	for (auto speakerIdx = 0; speakerIdx < m_numSpeakers; speakerIdx++)
+	{
+		auto const& speaker = speakerLayout.getSpeaker(speakerIdx);
+		if (speaker.isLFE)
+			continue;
+
+		m_pannedSpeakers.push_back(speakerIdx);
+
+		auto direction = speaker.position - SpeakerLayout::s_centrePos();
+		auto distance = direction.getDistanceFromOrigin();
+		if (distance > s_centreRadius)
+			directionalSpeakers.push_back({ getAzimuth(direction.getX(), direction.getY()), distance, speakerIdx });
+	}
+
+	// of several speakers in the same direction (e.g. height speakers projected onto the bed) only the outermost one is panned to
+	std::sort(directionalSpeakers.begin(), directionalSpeakers.end(), [](const DirectionalSpeaker& a, const DirectionalSpeaker& b) {
+		return a.azimuth != b.azimuth ? a.azimuth < b.azimuth : a.distance > b.distance;
+	});
+	directionalSpeakers.erase(std::unique(directionalSpeakers.begin(), directionalSpeakers.end(), [](const DirectionalSpeaker& a, const DirectionalSpeaker& b) {
+		return std::abs(a.azimuth - b.azimuth) < 0.01f;
+	}), directionalSpeakers.end());
+
+	// a single directional speaker gets every direction, this is expressed as a pair of the speaker with itself
+	auto numDirectionalSpeakers = static_cast<int>(directionalSpeakers.size());
+	for (auto i = 0; i < numDirectionalSpeakers; i++)
+	{
+		auto const& first = directionalSpeakers[i];
+		auto const& second = directionalSpeakers[(i + 1) % numDirectionalSpeakers];
+
+		SpeakerPair pair;
+		pair.first = first.speakerIdx;
+		pair.second = second.speakerIdx;
+		pair.startAzimuth = first.azimuth;
+		pair.span = second.azimuth - first.azimuth;
+		if (pair.span <= 0.0f)
+			pair.span += 360.0f;
+
+		// pairs that do not open up less than half a circle cannot reach every direction in between with positive gains
+		auto a = speakerLayout.getSpeakerPosition(pair.first) - SpeakerLayout::s_centrePos();
+		auto b = speakerLayout.getSpeakerPosition(pair.second) - SpeakerLayout::s_centrePos();
+		a /= a.getDistanceFromOrigin();
+		b /= b.getDistanceFromOrigin();
+		auto determinant = a.getX() * b.getY() - b.getX() * a.getY();
+		if (pair.span < 179.0f && std::abs(determinant) > 0.001f)
+		{
+			pair.hasInverse = true;
+			pair.inverse[0] = b.getY() / determinant;
+			pair.inverse[1] = -a.getY() / determinant;
+			pair.inverse[2] = -b.getX() / determinant;
+			pair.inverse[3] = a.getX() / determinant;
+		}
+
+		m_speakerPairs.push_back(pair);
+	}
+
+	if (m_speakerPairs.empty())
+		return;
+
+	// rounding can put a bin right onto the end of a pair or into a sliver between two pairs, so the search
+	// is bounded to one round like in findSpeakerPair
+	auto pairIdx = 0;
+	auto numPairs = static_cast<int>(m_speakerPairs.size());
+	for (auto binIdx = 0; binIdx < s_numLookupBins; binIdx++)
+	{
+		auto binAzimuth = -180.0f + 360.0f * static_cast<float>(binIdx) / static_cast<float>(s_numLookupBins);
+		for (auto i = 0; i < numPairs; i++)
+		{
+			auto const& pair = m_speakerPairs[pairIdx];
+			auto offset = binAzimuth - pair.startAzimuth;
+			if (offset < 0.0f)
+				offset += 360.0f;
+			if (offset <= pair.span)
+				break;
+			pairIdx = (pairIdx + 1) % numPairs;
+		}
+		m_lookup[binIdx] = pairIdx;
+	}
+}
+
+void VBAPPanner::computeGains(const juce::Point<float>& sourcePosition, float* gains, int numGains) const
+{
+	std::fill(gains, gains + numGains, 0.0f);
+	if (m_pannedSpeakers.empty())
+		return;
+
+	auto direction = sourcePosition - SpeakerLayout::s_centrePos();
+	auto distance = direction.getDistanceFromOrigin();
+	auto directionalPart = m_speakerPairs.empty() ? 0.0f : jmin(1.0f, distance / s_centreRadius);
+
+	if (directionalPart > 0.0f)
+	{
+		auto const& pair = m_speakerPairs[findSpeakerPair(getAzimuth(direction.getX(), direction.getY()))];
+
+		auto x = direction.getX() / distance;
+		auto y = direction.getY() / distance;
+		auto firstGain = 1.0f;
+		auto secondGain = 0.0f;
+		if (pair.hasInverse)
+		{
+			firstGain = jmax(0.0f, x * pair.inverse[0] + y * pair.inverse[2]);
+			secondGain = jmax(0.0f, x * pair.inverse[1] + y * pair.inverse[3]);
+		}
+		else if (pair.first != pair.second)
+		{
+			// wide pair, split by the angle travelled through its span
+			auto offset = getAzimuth(x, y) - pair.startAzimuth;
+			if (offset < 0.0f)
+				offset += 360.0f;
+			auto fraction = jlimit(0.0f, 1.0f, offset / pair.span);
+			firstGain = std::cos(fraction * MathConstants<float>::halfPi);
+			secondGain = std::sin(fraction * MathConstants<float>::halfPi);
+		}
+
+		// constant power across the pair
+		auto norm = std::sqrt(firstGain * firstGain + secondGain * secondGain);
+		if (norm > 0.0f)
+		{
+			if (pair.first < numGains)
+				gains[pair.first] += directionalPart * firstGain / norm;
+			if (pair.second < numGains)
+				gains[pair.second] += directionalPart * secondGain / norm;
+		}
+	}
+
+	if (directionalPart < 1.0f)
+	{
+		auto spreadGain = (1.0f - directionalPart) / std::sqrt(static_cast<float>(m_pannedSpeakers.size()));
+		for (auto speakerIdx : m_pannedSpeakers)
+			if (speakerIdx < numGains)
+				gains[speakerIdx] += spreadGain;
+
+		// the crossfade of both parts is renormalized to constant power as well
+		auto power = 0.0f;
+		for (auto i = 0; i < numGains; i++)
+			power += gains[i] * gains[i];
+		if (power > 0.0f)
+			FloatVectorOperations::multiply(gains, 1.0f / std::sqrt(power), numGains);
+	}
+}
+
+int VBAPPanner::findSpeakerPair(float azimuthDegrees) const
+{
+	// the bin gives the pair at the start of the bin, a pair boundary within the bin moves on to the following pair(s)
+	auto binIdx = jlimit(0, s_numLookupBins - 1, static_cast<int>((azimuthDegrees + 180.0f) * static_cast<float>(s_numLookupBins) / 360.0f));
+	auto pairIdx = m_lookup[binIdx];
+	auto numPairs = static_cast<int>(m_speakerPairs.size());
+	for (auto i = 0; i < numPairs; i++)
+	{
+		auto const& pair = m_speakerPairs[pairIdx];
+		auto offset = azimuthDegrees - pair.startAzimuth;
+		if (offset < 0.0f)
+			offset += 360.0f;
+		if (offset <= pair.span)
+			break;
+		pairIdx = (pairIdx + 1) % numPairs;
+	}
+
+	return pairIdx;
+}
+
+float VBAPPanner::getAzimuth(float x, float y)
+{
+	// degrees clockwise from the front, -180..180
+	return radiansToDegrees(std::atan2(x, y));
+}
+
+} // namespace SurroundFieldMixer
@@ -0,0 +1,79 @@
+/* Copyright (c) 2022, Christian Ahrens
+ *
+ * This file is part of SurroundFieldMixer <https://github.com/ChristianAhrens/SurroundFieldMixer>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "SpeakerLayout.h"
+
+
+namespace SurroundFieldMixer
+{
+
+//==============================================================================
+/*
+ * Two dimensional vector base amplitude panning over the speakers of a
+ * SpeakerLayout. When the layout is set, the speakers are sorted by azimuth
+ * around the field centre, every pair of neighbouring speakers gets its
+ * inverted 2x2 direction matrix and an azimuth lookup table maps each
+ * direction to the pair spanning it. Panning a source then is a table lookup
+ * and a 2x2 multiply, yielding at most two non-zero, power normalized gains.
+ * LFE speakers and speakers in the field centre have no direction and are
+ * left out. Sources close to the centre have no well defined direction
+ * either, those are faded into an equal power distribution over all speakers.
+ */
+class VBAPPanner
+{
+public:
+    VBAPPanner();
+    ~VBAPPanner();
+
+    //==============================================================================
+    void setSpeakerLayout(const SpeakerLayout& speakerLayout);
+
+    //==============================================================================
+    void computeGains(const juce::Point<float>& sourcePosition, float* gains, int numGains) const;
+
+    //==============================================================================
+    static constexpr int s_numLookupBins = 720; // half a degree per bin
+    static constexpr float s_centreRadius = 0.05f; // normalized distance from the centre below which sources are spread over all speakers
+
+private:
+    struct SpeakerPair
+    {
+        int     first{ 0 };
+        int     second{ 0 };
+        float   startAzimuth{ 0.0f };   // degrees, direction of the first speaker
+        float   span{ 0.0f };           // degrees clockwise from the first to the second speaker
+        float   inverse[4]{ 0.0f };     // row major inverse of the matrix with the two speaker directions as rows
+        bool    hasInverse{ false };    // false for pairs spanning 180 degrees or more, those are crossfaded by angle
+    };
+
+    int findSpeakerPair(float azimuthDegrees) const;
+    static float getAzimuth(float x, float y);
+
+    int                         m_numSpeakers{ 0 };
+    std::vector<int>            m_pannedSpeakers;       // all speakers but LFE, the ones the centre spread goes to
+    std::vector<SpeakerPair>    m_speakerPairs;         // sorted by start azimuth, neighbouring pairs share a speaker
+    std::array<int, s_numLookupBins> m_lookup{};        // per azimuth bin the pair spanning the start of the bin
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VBAPPanner)
+};
+
+} // namespace SurroundFieldMixer
@@ -156,6 +156,26 @@ unsigned int SurroundFieldMixerRemoteWrapper::getOutputScheme()
 	return m_outputScheme;
 }
 
+void SurroundFieldMixerRemoteWrapper::setDelayEnabled(bool enabled)
+{
+	m_delayEnabled = enabled;
+}
+
+bool SurroundFieldMixerRemoteWrapper::getDelayEnabled()
+{
+	return m_delayEnabled;
+}
+
+void SurroundFieldMixerRemoteWrapper::setReverbEnabled(bool enabled)
+{
+	m_reverbEnabled = enabled;
+}
+
+bool SurroundFieldMixerRemoteWrapper::getReverbEnabled()
+{
+	return m_reverbEnabled;
+}
+
 void SurroundFieldMixerRemoteWrapper::sendInputMute(unsigned int channel)
 {
 	int muteValue = m_inputMutes[channel] ? 1 : 0;
@@ -313,6 +333,40 @@ void SurroundFieldMixerRemoteWrapper::sendOutputScheme(unsigned int /*outputSche
 	/*t.b.d*/
 }
 
+void SurroundFieldMixerRemoteWrapper::sendDelayMode(unsigned int channel)
+{
+	// the distance delay is the full delay mode, it is switched for all inputs at once
+	int delayModeValue = m_delayEnabled ? 2 : 0;
+
+	RemoteObjectMessageData msgData;
+	msgData._addrVal._first = channel;
+	msgData._addrVal._second = 0;
+	msgData._valCount = 1;
+	msgData._valType = ROVT_INT;
+	msgData._payloadSize = sizeof(int);
+	msgData._payloadOwned = false;
+	msgData._payload = &delayModeValue;
+
+	SendMessage(ROI_Positioning_SourceDelayMode, msgData);
+}
+
+void SurroundFieldMixerRemoteWrapper::sendReverbRoom()
+{
+	// there is a single shared reverb, room 0 is reported while it is off
+	int reverbRoomValue = m_reverbEnabled ? 1 : 0;
+
+	RemoteObjectMessageData msgData;
+	msgData._addrVal._first = 0;
+	msgData._addrVal._second = 0;
+	msgData._valCount = 1;
+	msgData._valType = ROVT_INT;
+	msgData._payloadSize = sizeof(int);
+	msgData._payloadOwned = false;
+	msgData._payload = &reverbRoomValue;
+
+	SendMessage(ROI_MatrixSettings_ReverbRoomId, msgData);
+}
+
 /**
  * Send a Message out via the active bridging node.
  * @param Id	The id of the remote object to be sent.
@@ -521,6 +575,54 @@ void SurroundFieldMixerRemoteWrapper::HandleNodeData(const ProcessingEngineNode:
 			}
 		}
 		break;
+	case RemoteObjectIdentifier::ROI_Positioning_SourceDelayMode:
+		{
+			if (valuePoll)
+			{
+				if (delayEnabledPollCallback)
+					delayEnabledPollCallback();
+				sendDelayMode(channel);
+			}
+			else
+			{
+				auto valTypeMatch = messageDataValType == RemoteObjectValueType::ROVT_INT;
+				auto valCountMatch = 1 == messageDataValCount;
+				auto delayModeValPtr = reinterpret_cast<const int*>(messageDataPayload);
+				if (valTypeMatch && valCountMatch && delayModeValPtr)
+				{
+					// any delay mode other than off switches the distance delay on, for all inputs
+					auto delayEnabled = *delayModeValPtr != 0;
+					if (delayEnabledChangeCallback)
+						delayEnabledChangeCallback(delayEnabled);
+					setDelayEnabled(delayEnabled);
+				}
+			}
+		}
+		break;
+	case RemoteObjectIdentifier::ROI_MatrixSettings_ReverbRoomId:
+		{
+			if (valuePoll)
+			{
+				if (reverbEnabledPollCallback)
+					reverbEnabledPollCallback();
+				sendReverbRoom();
+			}
+			else
+			{
+				auto valTypeMatch = messageDataValType == RemoteObjectValueType::ROVT_INT;
+				auto valCountMatch = 1 == messageDataValCount;
+				auto reverbRoomValPtr = reinterpret_cast<const int*>(messageDataPayload);
+				if (valTypeMatch && valCountMatch && reverbRoomValPtr)
+				{
+					// any room switches the shared reverb on, room 0 switches it off
+					auto reverbEnabled = *reverbRoomValPtr != 0;
+					if (reverbEnabledChangeCallback)
+						reverbEnabledChangeCallback(reverbEnabled);
+					setReverbEnabled(reverbEnabled);
+				}
+			}
+		}
+		break;
 	case RemoteObjectIdentifier::ROI_MatrixOutput_Mute:
 		{
 			if (valuePoll)
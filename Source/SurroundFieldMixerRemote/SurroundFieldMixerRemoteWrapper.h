@@ -78,6 +78,20 @@ public:
 	float getOutputLevel(unsigned int channel);
 	unsigned int getOutputScheme();
 
+	//==========================================================================
+	// processing settings, not tied to a channel. Changes received by the remote are forwarded through the callbacks,
+	// polls first ask for the current value to be set before it is sent.
+	void setDelayEnabled(bool enabled);
+	bool getDelayEnabled();
+
+	void setReverbEnabled(bool enabled);
+	bool getReverbEnabled();
+
+	std::function<void(bool)>	delayEnabledChangeCallback;
+	std::function<void()>		delayEnabledPollCallback;
+	std::function<void(bool)>	reverbEnabledChangeCallback;
+	std::function<void()>		reverbEnabledPollCallback;
+
 	//==========================================================================
 	void Disconnect();
 	void Reconnect();
@@ -103,6 +117,10 @@ protected:
 	void sendOutputLevel(unsigned int channel);
 	void sendOutputScheme(unsigned int outputScheme);
 
+	//==========================================================================
+	void sendDelayMode(unsigned int channel);
+	void sendReverbRoom();
+
 private:
 	//==========================================================================
 	void HandleNodeData(const ProcessingEngineNode::NodeCallbackMessage* callbackMessage) override;
@@ -131,6 +149,10 @@ private:
 	std::map<unsigned int, float>	m_outputLevels;
 	unsigned int					m_outputScheme;
 
+	//==========================================================================
+	bool	m_delayEnabled{ false };
+	bool	m_reverbEnabled{ false };
+
 	//==========================================================================
 	servus::Servus m_servus; // instance of Servus (zeroconf mdns impl.) used to announce our OSC via UDP capability
 